@@ -11,6 +11,9 @@ This version demonstrates best coding practices and algorithmic design by:
 - Using a hash map for fast course lookup
 - Validating logical program flow and input data
 - Improving readability, maintainability, and correctness
+- Running parallel stages on one shared work-stealing scheduler
+
+Build (GCC/Clang): g++ -std=c++17 -O2 -pthread CS300_ver2.cpp
 */
 
 #include <iostream>
@@ -21,9 +24,316 @@ This version demonstrates best coding practices and algorithmic design by:
 #include <algorithm>
 #include <unordered_map>
 #include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <cstdlib>
+#include <cstdint>
+#include <string_view>
+#include <charconv>
+#include <chrono>
+#include <bitset>
+#include <unordered_set>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <cmath>
+#include <queue>
+#include <shared_mutex>
+#include <iomanip>
+#include <exception>
+#include <cerrno>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <linux/mempolicy.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COURSE_PLANNER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__PCLMUL__) && defined(COURSE_PLANNER_SSE2)
+#define COURSE_PLANNER_CLMUL 1
+#include <wmmintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
 
 using namespace std;
 
+// Forces buffered file data to stable storage
+#ifdef _WIN32
+#define FSYNC_FILE(file) _commit(_fileno(file))
+#else
+#define FSYNC_FILE(file) fsync(fileno(file))
+#endif
+
+// Hints the CPU to start loading a cache line before it is needed
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define PREFETCH(address) _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0)
+#else
+#define PREFETCH(address) ((void)0)
+#endif
+
+// Where large catalog storage comes from; see CatalogAllocator
+enum class HugePageMode { Off, Transparent, Explicit };
+
+namespace hugepages {
+
+const size_t kPageSize = size_t(2) << 20;
+const size_t kSmallLimit = 256;     // blocks up to this size come from the arena
+const size_t kSmallGranule = 16;
+
+// Bytes mapped so far by each mechanism, and explicit or advice requests refused
+struct Stats {
+    atomic<size_t> explicitBytes{ 0 };
+    atomic<size_t> transparentBytes{ 0 };
+    atomic<size_t> fallbacks{ 0 };
+};
+
+Stats& GetStats() {
+    static Stats stats;
+    return stats;
+}
+
+/*
+Mode given to allocators created from now on.
+Set it before building the structures it should apply to; structures
+that already exist keep the mode they were created with.
+*/
+HugePageMode& DefaultMode() {
+    static HugePageMode mode = HugePageMode::Off;
+    return mode;
+}
+
+bool Supported() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t RoundUp(size_t bytes) {
+    return (bytes + kPageSize - 1) & ~(kPageSize - 1);
+}
+
+/*
+Maps a block of whole 2MB pages, aligned to 2MB.
+Explicit mode asks for reserved huge pages (MAP_HUGETLB) first. When
+none are reserved, and always in transparent mode, an aligned anonymous
+mapping is advised to the kernel's transparent huge pages; if that
+advice is refused too the block still works on normal pages.
+Returns nullptr only when the address space is exhausted.
+*/
+void* MapPages(size_t bytes, HugePageMode mode) {
+#ifdef __linux__
+    Stats& stats = GetStats();
+    if (mode == HugePageMode::Explicit) {
+        void* block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block != MAP_FAILED) {
+            stats.explicitBytes += bytes;
+            return block;
+        }
+        stats.fallbacks++;
+    }
+
+    // Over-map by one page and trim both ends to leave an aligned run
+    size_t span = bytes + kPageSize;
+    void* raw = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + kPageSize - 1) & ~static_cast<uintptr_t>(kPageSize - 1);
+    if (aligned > start) munmap(raw, aligned - start);
+    size_t tail = start + span - (aligned + bytes);
+    if (tail > 0) munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+
+    void* block = reinterpret_cast<void*>(aligned);
+    if (madvise(block, bytes, MADV_HUGEPAGE) == 0) stats.transparentBytes += bytes;
+    else stats.fallbacks++;
+    return block;
+#else
+    (void)bytes;
+    (void)mode;
+    return nullptr;
+#endif
+}
+
+/*
+Bytes of this process's anonymous memory the kernel currently backs
+with huge pages, from /proc/self/smaps_rollup; 0 when unavailable.
+*/
+size_t ResidentHugeBytes() {
+    ifstream smaps("/proc/self/smaps_rollup");
+    string line;
+    while (getline(smaps, line)) {
+        if (line.compare(0, 14, "AnonHugePages:") == 0) {
+            return static_cast<size_t>(strtoull(line.c_str() + 14, nullptr, 10)) * 1024;
+        }
+    }
+    return 0;
+}
+
+void UnmapPages(void* block, size_t bytes) {
+#ifdef __linux__
+    munmap(block, bytes);
+#else
+    (void)block;
+    (void)bytes;
+#endif
+}
+
+/*
+Hands out node-sized blocks carved from 2MB huge-page chunks, so the
+nodes of a large map or tree share a few TLB entries instead of being
+spread across the general heap. Freed blocks go on a free list per
+16-byte size class and are reused; chunks are kept until exit.
+*/
+class Arena {
+private:
+    mutex lock;
+    HugePageMode mode;
+    void* freeLists[kSmallLimit / kSmallGranule] = {};
+    char* cursor = nullptr;
+    char* limit = nullptr;
+
+    static size_t sizeClass(size_t bytes) {
+        return bytes == 0 ? 0 : (bytes - 1) / kSmallGranule;
+    }
+
+public:
+    explicit Arena(HugePageMode chunkMode) : mode(chunkMode) {}
+
+    void* Allocate(size_t bytes) {
+        size_t index = sizeClass(bytes);
+        lock_guard<mutex> guard(lock);
+        if (freeLists[index] != nullptr) {
+            void* block = freeLists[index];
+            freeLists[index] = *static_cast<void**>(block);
+            return block;
+        }
+
+        size_t rounded = (index + 1) * kSmallGranule;
+        if (cursor == nullptr || static_cast<size_t>(limit - cursor) < rounded) {
+            cursor = static_cast<char*>(MapPages(kPageSize, mode));
+            if (cursor == nullptr) throw bad_alloc();
+            limit = cursor + kPageSize;
+        }
+        void* block = cursor;
+        cursor += rounded;
+        return block;
+    }
+
+    void Free(void* block, size_t bytes) {
+        size_t index = sizeClass(bytes);
+        lock_guard<mutex> guard(lock);
+        *static_cast<void**>(block) = freeLists[index];
+        freeLists[index] = block;
+    }
+};
+
+Arena& ArenaFor(HugePageMode mode) {
+    static Arena transparent(HugePageMode::Transparent);
+    static Arena explicitPages(HugePageMode::Explicit);
+    return mode == HugePageMode::Explicit ? explicitPages : transparent;
+}
+
+} // namespace hugepages
+
+/*
+Standard allocator for catalog storage.
+With huge pages off (the default) it is plain operator new. Otherwise
+node-sized blocks (map and tree nodes) come from the huge-page arena,
+blocks of at least one huge page (flat tables, bucket arrays) get their
+own aligned mapping, and sizes in between still use operator new.
+Each allocator keeps the mode it was created with, so containers built
+under different modes free their memory the way it was allocated.
+*/
+template <typename T>
+class CatalogAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = true_type;
+    using propagate_on_container_swap = true_type;
+
+    HugePageMode mode;
+
+    CatalogAllocator() noexcept
+        : mode(hugepages::Supported() ? hugepages::DefaultMode() : HugePageMode::Off) {
+    }
+
+    template <typename U>
+    CatalogAllocator(const CatalogAllocator<U>& other) noexcept : mode(other.mode) {}
+
+    T* allocate(size_t count) {
+        size_t bytes = count * sizeof(T);
+        if (mode != HugePageMode::Off) {
+            if (bytes <= hugepages::kSmallLimit && alignof(T) <= hugepages::kSmallGranule) {
+                return static_cast<T*>(hugepages::ArenaFor(mode).Allocate(bytes));
+            }
+            if (bytes >= hugepages::kPageSize) {
+                void* block = hugepages::MapPages(hugepages::RoundUp(bytes), mode);
+                if (block == nullptr) throw bad_alloc();
+                return static_cast<T*>(block);
+            }
+        }
+        return static_cast<T*>(::operator new(bytes));
+    }
+
+    void deallocate(T* block, size_t count) noexcept {
+        size_t bytes = count * sizeof(T);
+        if (mode != HugePageMode::Off) {
+            if (bytes <= hugepages::kSmallLimit && alignof(T) <= hugepages::kSmallGranule) {
+                hugepages::ArenaFor(mode).Free(block, bytes);
+                return;
+            }
+            if (bytes >= hugepages::kPageSize) {
+                hugepages::UnmapPages(block, hugepages::RoundUp(bytes));
+                return;
+            }
+        }
+        ::operator delete(block);
+    }
+
+    template <typename U>
+    bool operator==(const CatalogAllocator<U>& other) const { return mode == other.mode; }
+
+    template <typename U>
+    bool operator!=(const CatalogAllocator<U>& other) const { return mode != other.mode; }
+};
+
 /*
 Represents a single course record.
 This structure is intentionally simple and focused only on data storage.
@@ -34,18 +344,294 @@ struct Course {
     vector<string> prerequisites;        // List of prerequisite course numbers
 };
 
+// Two records are equal when every field matches
+bool operator==(const Course& a, const Course& b) {
+    return a.courseNumber == b.courseNumber
+        && a.courseTitle == b.courseTitle
+        && a.prerequisites == b.prerequisites;
+}
+
+inline bool IsCourseDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/*
+Three-way natural comparison of two course numbers.
+Text runs compare character by character, and a run that ends first
+sorts first. Digit runs compare by numeric value. When everything
+else is equal, the first run with more leading zeros sorts later.
+So CS200 < CS200L < CS0200L < CS1000 < CSA100. Returns 0 only for
+identical strings; CompareCourseKeys falls back to it on ties.
+*/
+int CompareCourseNumbers(string_view a, string_view b) {
+    size_t i = 0;
+    size_t j = 0;
+    int zeroOrder = 0;
+    while (i < a.size() || j < b.size()) {
+        while (i < a.size() && j < b.size() && !IsCourseDigit(a[i]) && !IsCourseDigit(b[j])) {
+            if (a[i] != b[j]) {
+                return static_cast<unsigned char>(a[i]) < static_cast<unsigned char>(b[j]) ? -1 : 1;
+            }
+            ++i;
+            ++j;
+        }
+        bool aText = i < a.size() && !IsCourseDigit(a[i]);
+        bool bText = j < b.size() && !IsCourseDigit(b[j]);
+        if (aText != bText) return aText ? 1 : -1;
+
+        size_t aStart = i;
+        size_t bStart = j;
+        while (i < a.size() && IsCourseDigit(a[i])) ++i;
+        while (j < b.size() && IsCourseDigit(b[j])) ++j;
+        size_t aLead = aStart;
+        size_t bLead = bStart;
+        while (aLead < i && a[aLead] == '0') ++aLead;
+        while (bLead < j && b[bLead] == '0') ++bLead;
+
+        // A longer run of significant digits is a larger number
+        if (i - aLead != j - bLead) return (i - aLead) < (j - bLead) ? -1 : 1;
+        int order = a.substr(aLead, i - aLead).compare(b.substr(bLead, j - bLead));
+        if (order != 0) return order < 0 ? -1 : 1;
+        if (zeroOrder == 0 && i - aStart != j - bStart) zeroOrder = (i - aStart) < (j - bStart) ? -1 : 1;
+    }
+    return zeroOrder;
+}
+
+/*
+Parsed course number: the department prefix (everything before the
+first digit) and the value of the digit run after it.
+department packs the first eight prefix characters big-endian, so
+comparing it as an integer matches comparing the characters. A key is
+exact when its prefix has at most eight characters and its number at
+most 19 digits; for two exact keys a difference in either integer
+decides the natural order without looking at the strings again.
+*/
+struct CourseKey {
+    uint64_t department = 0;
+    uint64_t number = 0;
+    bool exact = true;
+
+    static CourseKey Parse(string_view text) {
+        CourseKey key;
+        size_t i = 0;
+        for (; i < text.size() && !IsCourseDigit(text[i]); ++i) {
+            if (i < 8) key.department |= uint64_t(static_cast<unsigned char>(text[i])) << (56 - 8 * i);
+        }
+        size_t digitsStart = i;
+        for (; i < text.size() && IsCourseDigit(text[i]); ++i) {
+            key.number = key.number * 10 + static_cast<uint64_t>(text[i] - '0');
+        }
+        key.exact = digitsStart <= 8 && i - digitsStart <= 19;
+        return key;
+    }
+};
+
+/*
+Natural three-way comparison of two course numbers with their parsed
+keys: two integer comparisons decide almost every pair, and only ties
+(same department and number) read the strings.
+*/
+inline int CompareCourseKeys(const CourseKey& a, string_view aText,
+    const CourseKey& b, string_view bText) {
+    if (a.exact && b.exact) {
+        int order = (a.department > b.department) - (a.department < b.department);
+        if (order == 0) order = (a.number > b.number) - (a.number < b.number);
+        if (order != 0) return order;
+    }
+    return CompareCourseNumbers(aText, bText);
+}
+
+// Final mixing step of MurmurHash3: every input bit affects every output bit
+inline uint64_t MixHashBits(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t LoadWord64(const char* bytes) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+inline uint32_t LoadWord32(const char* bytes) {
+    uint32_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+/*
+Hash of a course number, eight bytes at a time.
+The last word is read as the final eight bytes (overlapping the one
+before) and short keys as two overlapping four-byte loads, so there is
+no byte loop and no variable-length copy; a typical course number costs
+one or two loads, a multiply and one final mix. Equal strings always
+hash equal, which is all the natural ordering's equality requires.
+*/
+inline uint64_t HashCourseNumber(string_view text) {
+    const uint64_t kMultiplier = 0x9E3779B97F4A7C15ULL;
+    const char* bytes = text.data();
+    size_t size = text.size();
+    uint64_t h = size * kMultiplier;
+    uint64_t last = 0;
+    if (size >= 8) {
+        for (size_t i = 0; i + 8 < size; i += 8) {
+            h = (h ^ LoadWord64(bytes + i)) * kMultiplier;
+            h ^= h >> 32;
+        }
+        last = LoadWord64(bytes + size - 8);
+    }
+    else if (size >= 4) {
+        last = LoadWord32(bytes) | (uint64_t(LoadWord32(bytes + size - 4)) << 32);
+    }
+    else if (size > 0) {
+        last = uint64_t(static_cast<unsigned char>(bytes[0]))
+            | uint64_t(static_cast<unsigned char>(bytes[size / 2])) << 8
+            | uint64_t(static_cast<unsigned char>(bytes[size - 1])) << 16;
+    }
+    return MixHashBits(h ^ last);
+}
+
+struct CourseNumberHash {
+    size_t operator()(string_view text) const { return static_cast<size_t>(HashCourseNumber(text)); }
+};
+
+/*
+Natural ordering of course numbers for ordered containers; it names its
+hash and equality so hashed containers keyed the same way agree with it.
+*/
+struct CourseNumberLess {
+    using hash_type = CourseNumberHash;
+    using equal_type = equal_to<string>;
+
+    bool operator()(string_view a, string_view b) const {
+        return CompareCourseKeys(CourseKey::Parse(a), a, CourseKey::Parse(b), b) < 0;
+    }
+};
+
+// Owning map from course number to record; its nodes follow the huge-page mode
+using CourseMap = unordered_map<string, Course, CourseNumberHash, equal_to<string>,
+    CatalogAllocator<pair<const string, Course>>>;
+
+/*
+Heap memory attributed to one structure.
+used counts bytes holding data; slack counts allocated bytes nothing
+uses (spare vector and string capacity, empty buckets and slots);
+allocations counts separate heap blocks, each of which also costs the
+allocator a header and rounding on top of its size.
+*/
+struct MemoryUsage {
+    size_t entries = 0;
+    size_t used = 0;
+    size_t slack = 0;
+    size_t allocations = 0;
+
+    void Add(const MemoryUsage& other) {
+        entries += other.entries;
+        used += other.used;
+        slack += other.slack;
+        allocations += other.allocations;
+    }
+};
+
+// Longest string kept inside the string object itself (small-string optimization)
+const size_t kInlineStringCapacity = string().capacity();
+
+// Adds the heap block of a string that has spilled out of its inline buffer
+void AddStringUsage(const string& text, MemoryUsage& usage) {
+    if (text.capacity() <= kInlineStringCapacity) return;
+    usage.used += text.size() + 1;
+    usage.slack += text.capacity() - text.size();
+    usage.allocations++;
+}
+
+// Adds the strings of a list and the list's own array
+void AddStringListUsage(const vector<string>& list, MemoryUsage& usage) {
+    if (list.capacity() > 0) {
+        usage.used += list.size() * sizeof(string);
+        usage.slack += (list.capacity() - list.size()) * sizeof(string);
+        usage.allocations++;
+    }
+    for (const auto& text : list) AddStringUsage(text, usage);
+}
+
+// Adds what a course record owns on the heap, not the record itself
+void AddCourseUsage(const Course& course, MemoryUsage& usage) {
+    AddStringUsage(course.courseNumber, usage);
+    AddStringUsage(course.courseTitle, usage);
+    AddStringListUsage(course.prerequisites, usage);
+}
+
+/*
+Element nodes of a node-based hash map: each holds the element, the
+next pointer and, for string keys, the cached hash.
+*/
+template <typename Map>
+MemoryUsage HashNodeUsage(const Map& map) {
+    MemoryUsage usage;
+    usage.entries = map.size();
+    usage.used = map.size() * (sizeof(typename Map::value_type) + sizeof(void*) + sizeof(size_t));
+    usage.allocations = map.size();
+    return usage;
+}
+
+// Bucket array of a hash map; buckets beyond one per element are slack
+template <typename Map>
+MemoryUsage HashBucketUsage(const Map& map) {
+    MemoryUsage usage;
+    size_t buckets = map.bucket_count();
+    size_t needed = min(map.size(), buckets);
+    usage.entries = buckets;
+    usage.used = needed * sizeof(void*);
+    usage.slack = (buckets - needed) * sizeof(void*);
+    usage.allocations = buckets > 1 ? 1 : 0;
+    return usage;
+}
+
+// Releases spare capacity in a list of strings; short strings move back inline
+void CompactStringList(vector<string>& list) {
+    for (auto& text : list) text.shrink_to_fit();
+    list.shrink_to_fit();
+}
+
+// Releases spare capacity held by a course record
+void CompactCourse(Course& course) {
+    course.courseNumber.shrink_to_fit();
+    course.courseTitle.shrink_to_fit();
+    CompactStringList(course.prerequisites);
+}
+
+bool operator!=(const Course& a, const Course& b) {
+    return !(a == b);
+}
+
 /*
 Node structure used by the Binary Search Tree.
 Each node stores a Course and pointers to left/right children.
+subtreeSize counts this node plus all of its descendants, which lets
+the tree answer rank and position queries without a full traversal.
+key is the parsed course number, so most comparisons on the way down
+are two integer compares instead of a string comparison.
 */
 struct Node {
     Course course;
+    CourseKey key;
     Node* left;
     Node* right;
+    size_t subtreeSize;
 
     // Constructor initializes node with no children
     Node(const Course& newCourse)
-        : course(newCourse), left(nullptr), right(nullptr) {
+        : course(newCourse), key(CourseKey::Parse(newCourse.courseNumber)),
+        left(nullptr), right(nullptr), subtreeSize(1) {
+    }
+
+    // Natural order of a course number relative to this node's course
+    int Compare(const CourseKey& otherKey, const string& courseNumber) const {
+        return CompareCourseKeys(otherKey, courseNumber, key, course.courseNumber);
     }
 };
 
@@ -54,6 +640,7 @@ Binary Search Tree class.
 Purpose:
 - Maintain courses in sorted order by course number
 - Support in-order traversal for displaying a structured course list
+- Support order-statistic queries (i-th course, rank, pages of courses)
 
 Note:
 - BST is NOT used for searching in this enhanced version
@@ -62,22 +649,42 @@ Note:
 class CourseBST {
 private:
     Node* root;
+    CatalogAllocator<Node> nodeAllocator;
+
+    Node* createNode(const Course& course) {
+        Node* node = nodeAllocator.allocate(1);
+        return new (node) Node(course);
+    }
+
+    void destroyNode(Node* node) {
+        node->~Node();
+        nodeAllocator.deallocate(node, 1);
+    }
+
+    // Size of a possibly empty subtree
+    static size_t sizeOf(const Node* node) {
+        return node == nullptr ? 0 : node->subtreeSize;
+    }
 
     /*
     Recursive insertion function.
-    Courses are ordered lexicographically by course number.
+    Courses are ordered naturally by course number (see CourseKey).
+    Every node on the insertion path gains one descendant.
     Average complexity: O(log n)
     Worst case: O(n)
     */
-    void insertNode(Node*& node, const Course& course) {
+    void insertNode(Node*& node, const Course& course, const CourseKey& key) {
         if (node == nullptr) {
-            node = new Node(course);
+            node = createNode(course);
+            return;
         }
-        else if (course.courseNumber < node->course.courseNumber) {
-            insertNode(node->left, course);
+
+        node->subtreeSize++;
+        if (node->Compare(key, course.courseNumber) < 0) {
+            insertNode(node->left, course, key);
         }
         else {
-            insertNode(node->right, course);
+            insertNode(node->right, course, key);
         }
     }
 
@@ -94,123 +701,7035 @@ private:
         }
     }
 
+    /*
+    Removes the course with the given number from the subtree.
+    A node with two children takes over its in-order successor's course
+    and the successor is removed from the right subtree instead.
+    Subtree sizes shrink along the path only when a node was removed.
+    Average complexity: O(log n)
+    */
+    bool removeNode(Node*& node, const string& courseNumber, const CourseKey& key) {
+        if (node == nullptr) return false;
+
+        bool removed;
+        int order = node->Compare(key, courseNumber);
+        if (order < 0) {
+            removed = removeNode(node->left, courseNumber, key);
+        }
+        else if (order > 0) {
+            removed = removeNode(node->right, courseNumber, key);
+        }
+        else if (node->left == nullptr || node->right == nullptr) {
+            Node* child = (node->left != nullptr) ? node->left : node->right;
+            destroyNode(node);
+            node = child;
+            return true;
+        }
+        else {
+            Node* successor = node->right;
+            while (successor->left != nullptr) successor = successor->left;
+            node->course = successor->course;
+            node->key = successor->key;
+            removed = removeNode(node->right, node->course.courseNumber, node->key);
+        }
+
+        if (removed) node->subtreeSize--;
+        return removed;
+    }
+
+    // Locates the node holding a course number, or nullptr
+    Node* findNode(const string& courseNumber) const {
+        CourseKey key = CourseKey::Parse(courseNumber);
+        Node* node = root;
+        while (node != nullptr) {
+            int order = node->Compare(key, courseNumber);
+            if (order == 0) break;
+            node = (order < 0) ? node->left : node->right;
+        }
+        return node;
+    }
+
+    // Builds a balanced subtree from sorted[begin, end); recursion depth is O(log n)
+    Node* buildBalanced(const vector<const Course*>& sorted, size_t begin, size_t end) {
+        if (begin >= end) return nullptr;
+        size_t middle = begin + (end - begin) / 2;
+        Node* node = createNode(*sorted[middle]);
+        node->left = buildBalanced(sorted, begin, middle);
+        node->right = buildBalanced(sorted, middle + 1, end);
+        node->subtreeSize = end - begin;
+        return node;
+    }
+
+    // Frees a subtree iteratively so deep trees cannot overflow the stack
+    void destroyTree(Node* node) {
+        vector<Node*> pending;
+        if (node != nullptr) pending.push_back(node);
+        while (!pending.empty()) {
+            Node* current = pending.back();
+            pending.pop_back();
+            if (current->left != nullptr) pending.push_back(current->left);
+            if (current->right != nullptr) pending.push_back(current->right);
+            destroyNode(current);
+        }
+    }
+
 public:
     CourseBST() : root(nullptr) {}
 
-    // Public insert method hides recursive implementation details
-    void Insert(const Course& course) {
-        insertNode(root, course);
+    ~CourseBST() { destroyTree(root); }
+
+    // The tree owns its nodes, so copies are not allowed
+    CourseBST(const CourseBST&) = delete;
+    CourseBST& operator=(const CourseBST&) = delete;
+
+    // Removes every course from the tree
+    void Clear() {
+        destroyTree(root);
+        root = nullptr;
     }
 
-    // Prints all courses in sorted order
-    void PrintSortedCourses() const {
-        inOrderTraversal(root);
+    /*
+    Replaces the contents with a perfectly balanced tree of the given
+    courses, which must be sorted by course number and distinct. O(n).
+    */
+    void BuildBalanced(const vector<const Course*>& sorted) {
+        Clear();
+        root = buildBalanced(sorted, 0, sorted.size());
     }
-};
 
-/*
-Loads course data from a CSV file.
-Courses are stored in:
-- BST for sorted traversal
-- Hash map for fast lookup
+    // Public insert method hides recursive implementation details
+    void Insert(const Course& course) {
+        insertNode(root, course, CourseKey::Parse(course.courseNumber));
+    }
 
-This hybrid approach demonstrates algorithmic trade-offs.
-*/
-void LoadCourses(
-    const string& filename,
-    CourseBST& bst,
-    unordered_map<string, Course>& courseMap
-) {
-    ifstream file(filename);
-    if (!file.is_open()) {
-        cout << "Error: Unable to open file " << filename << endl;
-        return;
+    // Removes a course by number; returns false when it is not in the tree
+    bool Remove(const string& courseNumber) {
+        return removeNode(root, courseNumber, CourseKey::Parse(courseNumber));
     }
 
-    string line;
-    while (getline(file, line)) {
-        if (line.empty()) continue; // Skip empty lines
+    /*
+    Replaces the stored record of an existing course in place.
+    The course number is the sort key, so the node does not move.
+    Returns false when the course is not in the tree.
+    */
+    bool Update(const Course& course) {
+        Node* node = findNode(course.courseNumber);
+        if (node == nullptr) return false;
+        node->course = course;
+        return true;
+    }
 
-        stringstream ss(line);
-        Course course;
-        string token;
+    /*
+    Searches the tree by course number.
+    Lookups go through the hash table; this exists so the layout
+    benchmark can measure an insertion-ordered tree as its baseline.
+    */
+    const Course* Find(const string& courseNumber) const {
+        const Node* node = findNode(courseNumber);
+        return node == nullptr ? nullptr : &node->course;
+    }
 
-        // Parse course number and title
-        getline(ss, course.courseNumber, ',');
-        getline(ss, course.courseTitle, ',');
+    // Number of courses stored in the tree
+    size_t Size() const {
+        return sizeOf(root);
+    }
 
-        // Parse prerequisite list
-        while (getline(ss, token, ',')) {
-            token.erase(0, token.find_first_not_of(" "));
-            token.erase(token.find_last_not_of(" ") + 1);
-            if (!token.empty()) {
-                course.prerequisites.push_back(token);
+    /*
+    Returns the course at the given zero-based position in sorted order,
+    or nullptr when the position is past the end.
+    Subtree sizes decide at each node whether to go left, stop or go right.
+    Average complexity: O(log n)
+    */
+    const Course* Select(size_t index) const {
+        const Node* node = root;
+        while (node != nullptr) {
+            size_t leftSize = sizeOf(node->left);
+            if (index < leftSize) {
+                node = node->left;
+            }
+            else if (index == leftSize) {
+                return &node->course;
+            }
+            else {
+                index -= leftSize + 1;
+                node = node->right;
             }
         }
-
-        // Insert into both data structures
-        bst.Insert(course);
-        courseMap[course.courseNumber] = course;
+        return nullptr;
     }
 
-    file.close();
-
     /*
-    Validate prerequisite references.
-    This defensive check prevents silent logical flaws
-    caused by missing or incorrect prerequisite data.
+    Returns how many courses sort before the given course number.
+    For a stored course this is its zero-based position in the list.
+    Average complexity: O(log n)
     */
-    for (const auto& pair : courseMap) {
-        for (const auto& prereq : pair.second.prerequisites) {
-            if (courseMap.find(prereq) == courseMap.end()) {
-                cout << "Warning: Course " << pair.first
-                    << " references missing prerequisite "
-                    << prereq << endl;
+    size_t Rank(const string& courseNumber) const {
+        CourseKey key = CourseKey::Parse(courseNumber);
+        size_t rank = 0;
+        const Node* node = root;
+        while (node != nullptr) {
+            if (node->Compare(key, courseNumber) <= 0) {
+                node = node->left;
+            }
+            else {
+                rank += sizeOf(node->left) + 1;
+                node = node->right;
             }
         }
+        return rank;
     }
-}
 
-/*
-Prints detailed information for a single course.
-Uses hash map lookup for O(1) average-time access.
-*/
-void PrintCourseDetails(
-    const string& courseNumber,
-    const unordered_map<string, Course>& courseMap
-) {
-    auto it = courseMap.find(courseNumber);
-    if (it == courseMap.end()) {
-        cout << "Course not found." << endl;
-        return;
+    // Heap memory held by the nodes and the course copies inside them
+    MemoryUsage Footprint() const {
+        vector<const Course*> courses;
+        CollectInOrder(courses);
+        MemoryUsage usage;
+        usage.entries = courses.size();
+        usage.used = courses.size() * sizeof(Node);
+        usage.allocations = courses.size();
+        for (const Course* course : courses) AddCourseUsage(*course, usage);
+        return usage;
     }
 
-    const Course& course = it->second;
-    cout << course.courseNumber << ", " << course.courseTitle << endl;
-
-    if (course.prerequisites.empty()) {
-        cout << "Prerequisites: None" << endl;
-    }
-    else {
-        cout << "Prerequisites: ";
-        for (size_t i = 0; i < course.prerequisites.size(); ++i) {
-            cout << course.prerequisites[i];
-            if (i < course.prerequisites.size() - 1) cout << ", ";
+    /*
+    Appends every course to the output vector in sorted order.
+    Iterative so very deep (unbalanced) trees cannot overflow the stack.
+    */
+    void CollectInOrder(vector<const Course*>& courses) const {
+        courses.reserve(courses.size() + Size());
+        vector<const Node*> pending;
+        const Node* node = root;
+        while (node != nullptr || !pending.empty()) {
+            while (node != nullptr) {
+                pending.push_back(node);
+                node = node->left;
+            }
+            node = pending.back();
+            pending.pop_back();
+            courses.push_back(&node->course);
+            node = node->right;
         }
-        cout << endl;
     }
-}
 
-/*
-Main program loop.
-Includes input validation and logical flow checks
-to prevent user actions before data is loaded.
+    /*
+    Appends up to count courses starting at a zero-based position.
+    The descent to the first course records the ancestors still to be
+    visited on a stack, then an iterative in-order walk continues from
+    there, so a range costs O(log n + count) instead of a full traversal.
+    */
+    void CollectRange(size_t first, size_t count, vector<const Course*>& courses) const {
+        vector<const Node*> pending;
+        const Node* node = root;
+        size_t index = first;
+        while (node != nullptr) {
+            size_t leftSize = sizeOf(node->left);
+            if (index < leftSize) {
+                pending.push_back(node);
+                node = node->left;
+            }
+            else if (index == leftSize) {
+                pending.push_back(node);
+                break;
+            }
+            else {
+                index -= leftSize + 1;
+                node = node->right;
+            }
+        }
+
+        while (count > 0 && !pending.empty()) {
+            node = pending.back();
+            pending.pop_back();
+            courses.push_back(&node->course);
+            count--;
+
+            // Next in-order node is the leftmost node of the right subtree
+            for (node = node->right; node != nullptr; node = node->left) {
+                pending.push_back(node);
+            }
+        }
+    }
+
+    // Prints up to count courses starting at a zero-based position
+    void PrintRange(size_t first, size_t count) const {
+        vector<const Course*> courses;
+        CollectRange(first, count, courses);
+        for (const Course* course : courses) {
+            cout << course->courseNumber << ", " << course->courseTitle << endl;
+        }
+    }
+
+    // Prints all courses in sorted order
+    void PrintSortedCourses() const {
+        inOrderTraversal(root);
+    }
+};
+
+/*
+Hash and equality used by the hash storage policy for a given key
+ordering. std::hash and std::equal_to by default; an ordering that
+knows a faster hash for its keys declares it as nested hash_type and
+equal_type.
+*/
+template <typename Key, typename Compare, typename = void>
+struct IndexHashing {
+    using hash_type = hash<Key>;
+    using equal_type = equal_to<Key>;
+};
+
+template <typename Key, typename Compare>
+struct IndexHashing<Key, Compare, void_t<typename Compare::hash_type, typename Compare::equal_type>> {
+    using hash_type = typename Compare::hash_type;
+    using equal_type = typename Compare::equal_type;
+};
+
+/*
+Storage policies for GenericIndex.
+Every policy stores unique keys with one value each and provides
+    void Assign(vector<pair<Key, Value>>&&)
+                                       replaces the contents with entries
+                                       sorted by key and distinct
+    bool Insert(const Key&, Value)     false when the key was present
+                                       (its value is replaced)
+    const Value* Find(const Key&) const
+    bool Erase(const Key&)
+    size_t Size() const
+    void ForEach(Visit) const          calls visit(key, value); in key
+                                       order when kOrdered is true
+
+PointerTreeStorage: unbalanced binary search tree with one node per
+entry, the layout of CourseBST. Cheap inserts in random order, but
+every level of a search is a dependent cache miss.
+*/
+template <typename Key, typename Value, typename Compare>
+class PointerTreeStorage {
+private:
+    struct TreeNode {
+        Key key;
+        Value value;
+        TreeNode* left = nullptr;
+        TreeNode* right = nullptr;
+    };
+
+    TreeNode* root = nullptr;
+    size_t count = 0;
+    Compare less;
+    CatalogAllocator<TreeNode> nodeAllocator;
+
+    void destroy(TreeNode* node) {
+        vector<TreeNode*> pending;
+        if (node != nullptr) pending.push_back(node);
+        while (!pending.empty()) {
+            TreeNode* current = pending.back();
+            pending.pop_back();
+            if (current->left != nullptr) pending.push_back(current->left);
+            if (current->right != nullptr) pending.push_back(current->right);
+            current->~TreeNode();
+            nodeAllocator.deallocate(current, 1);
+        }
+    }
+
+    // Balanced subtree over sorted[begin, end); recursion depth is O(log n)
+    TreeNode* build(vector<pair<Key, Value>>& sorted, size_t begin, size_t end) {
+        if (begin >= end) return nullptr;
+        size_t middle = begin + (end - begin) / 2;
+        TreeNode* node = new (nodeAllocator.allocate(1))
+            TreeNode{ move(sorted[middle].first), move(sorted[middle].second) };
+        node->left = build(sorted, begin, middle);
+        node->right = build(sorted, middle + 1, end);
+        return node;
+    }
+
+public:
+    static constexpr bool kOrdered = true;
+
+    PointerTreeStorage() = default;
+    ~PointerTreeStorage() { destroy(root); }
+
+    PointerTreeStorage(const PointerTreeStorage&) = delete;
+    PointerTreeStorage& operator=(const PointerTreeStorage&) = delete;
+
+    void Assign(vector<pair<Key, Value>>&& sorted) {
+        destroy(root);
+        root = build(sorted, 0, sorted.size());
+        count = sorted.size();
+    }
+
+    bool Insert(const Key& key, Value value) {
+        TreeNode** link = &root;
+        while (*link != nullptr) {
+            TreeNode* node = *link;
+            if (less(key, node->key)) link = &node->left;
+            else if (less(node->key, key)) link = &node->right;
+            else {
+                node->value = move(value);
+                return false;
+            }
+        }
+        *link = new (nodeAllocator.allocate(1)) TreeNode{ key, move(value) };
+        count++;
+        return true;
+    }
+
+    const Value* Find(const Key& key) const {
+        const TreeNode* node = root;
+        while (node != nullptr) {
+            if (less(key, node->key)) node = node->left;
+            else if (less(node->key, key)) node = node->right;
+            else return &node->value;
+        }
+        return nullptr;
+    }
+
+    // A node with two children takes its successor's entry; the successor node is unlinked
+    bool Erase(const Key& key) {
+        TreeNode** link = &root;
+        while (*link != nullptr && (less(key, (*link)->key) || less((*link)->key, key))) {
+            link = less(key, (*link)->key) ? &(*link)->left : &(*link)->right;
+        }
+        TreeNode* node = *link;
+        if (node == nullptr) return false;
+
+        if (node->left != nullptr && node->right != nullptr) {
+            TreeNode** successorLink = &node->right;
+            while ((*successorLink)->left != nullptr) successorLink = &(*successorLink)->left;
+            TreeNode* successor = *successorLink;
+            node->key = move(successor->key);
+            node->value = move(successor->value);
+            link = successorLink;
+            node = successor;
+        }
+        *link = (node->left != nullptr) ? node->left : node->right;
+        node->~TreeNode();
+        nodeAllocator.deallocate(node, 1);
+        count--;
+        return true;
+    }
+
+    size_t Size() const { return count; }
+
+    template <typename Visit>
+    void ForEach(const Visit& visit) const {
+        vector<const TreeNode*> pending;
+        const TreeNode* node = root;
+        while (node != nullptr || !pending.empty()) {
+            while (node != nullptr) {
+                pending.push_back(node);
+                node = node->left;
+            }
+            node = pending.back();
+            pending.pop_back();
+            visit(node->key, node->value);
+            node = node->right;
+        }
+    }
+};
+
+/*
+FlatSortedStorage: entries in one sorted array searched by binary
+search. Densest layout and the fastest scans; an insert or erase in the
+middle shifts the tail, so it suits data loaded once (appends in key
+order are O(1)) and read many times.
+*/
+template <typename Key, typename Value, typename Compare>
+class FlatSortedStorage {
+private:
+    vector<pair<Key, Value>, CatalogAllocator<pair<Key, Value>>> entries;
+    Compare less;
+
+    typename decltype(entries)::const_iterator position(const Key& key) const {
+        return lower_bound(entries.begin(), entries.end(), key,
+            [this](const pair<Key, Value>& entry, const Key& k) { return less(entry.first, k); });
+    }
+
+public:
+    static constexpr bool kOrdered = true;
+
+    void Assign(vector<pair<Key, Value>>&& sorted) {
+        entries.assign(make_move_iterator(sorted.begin()), make_move_iterator(sorted.end()));
+    }
+
+    bool Insert(const Key& key, Value value) {
+        if (entries.empty() || less(entries.back().first, key)) {
+            entries.emplace_back(key, move(value));
+            return true;
+        }
+        auto found = entries.begin() + (position(key) - entries.cbegin());
+        if (!less(key, found->first)) {
+            found->second = move(value);
+            return false;
+        }
+        entries.emplace(found, key, move(value));
+        return true;
+    }
+
+    const Value* Find(const Key& key) const {
+        auto found = position(key);
+        if (found == entries.end() || less(key, found->first)) return nullptr;
+        return &found->second;
+    }
+
+    bool Erase(const Key& key) {
+        auto found = position(key);
+        if (found == entries.end() || less(key, found->first)) return false;
+        entries.erase(found);
+        return true;
+    }
+
+    size_t Size() const { return entries.size(); }
+
+    template <typename Visit>
+    void ForEach(const Visit& visit) const {
+        for (const auto& entry : entries) visit(entry.first, entry.second);
+    }
+};
+
+/*
+BTreeStorage: B+ tree with up to kFanout keys per node. Values live in
+the leaves, which are chained for in-order scans; inner nodes hold only
+separator keys, so a search touches a few wide nodes instead of a
+long chain of small ones.
+Erase removes the entry from its leaf without merging nodes. Inner
+separators stay valid routing keys, so searches remain correct and cost
+O(log n) of the largest size the tree has held.
+*/
+template <typename Key, typename Value, typename Compare>
+class BTreeStorage {
+private:
+    static const size_t kFanout = 16;
+
+    struct BNode {
+        bool leaf;
+        size_t count = 0;
+        Key keys[kFanout + 1];   // one spare slot holds the overflow before a split
+        explicit BNode(bool isLeaf) : leaf(isLeaf) {}
+    };
+
+    struct Leaf : BNode {
+        Value values[kFanout + 1];
+        Leaf* next = nullptr;
+        Leaf() : BNode(true) {}
+    };
+
+    struct Inner : BNode {
+        BNode* children[kFanout + 2] = {};
+        Inner() : BNode(false) {}
+    };
+
+    BNode* root = nullptr;
+    size_t size = 0;
+    Compare less;
+    CatalogAllocator<Leaf> leafAllocator;
+    CatalogAllocator<Inner> innerAllocator;
+
+    Leaf* newLeaf() { return new (leafAllocator.allocate(1)) Leaf(); }
+    Inner* newInner() { return new (innerAllocator.allocate(1)) Inner(); }
+
+    size_t lowerBound(const BNode* node, const Key& key) const {
+        return lower_bound(node->keys, node->keys + node->count, key, less) - node->keys;
+    }
+
+    // Child to descend into: keys equal to a separator live to its right
+    size_t childIndex(const Inner* node, const Key& key) const {
+        return upper_bound(node->keys, node->keys + node->count, key, less) - node->keys;
+    }
+
+    void destroy(BNode* node) {
+        if (node == nullptr) return;
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            leaf->~Leaf();
+            leafAllocator.deallocate(leaf, 1);
+            return;
+        }
+        Inner* inner = static_cast<Inner*>(node);
+        for (size_t i = 0; i <= inner->count; ++i) destroy(inner->children[i]);
+        inner->~Inner();
+        innerAllocator.deallocate(inner, 1);
+    }
+
+    /*
+    Inserts below node. When node overflows it is split: its upper half
+    moves to a new right sibling, returned through split together with
+    the separator key to add to the parent.
+    */
+    bool insert(BNode* node, const Key& key, Value& value, Key& separator, BNode*& split) {
+        split = nullptr;
+        bool inserted;
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+            size_t at = lowerBound(leaf, key);
+            if (at < leaf->count && !less(key, leaf->keys[at])) {
+                leaf->values[at] = move(value);
+                return false;
+            }
+            move_backward(leaf->keys + at, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+            move_backward(leaf->values + at, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+            leaf->keys[at] = key;
+            leaf->values[at] = move(value);
+            leaf->count++;
+            if (leaf->count <= kFanout) return true;
+
+            Leaf* right = newLeaf();
+            size_t keep = leaf->count / 2;
+            right->count = leaf->count - keep;
+            move(leaf->keys + keep, leaf->keys + leaf->count, right->keys);
+            move(leaf->values + keep, leaf->values + leaf->count, right->values);
+            leaf->count = keep;
+            right->next = leaf->next;
+            leaf->next = right;
+            separator = right->keys[0];
+            split = right;
+            return true;
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+        size_t child = childIndex(inner, key);
+        Key childSeparator;
+        BNode* childSplit;
+        inserted = insert(inner->children[child], key, value, childSeparator, childSplit);
+        if (childSplit == nullptr) return inserted;
+
+        move_backward(inner->keys + child, inner->keys + inner->count, inner->keys + inner->count + 1);
+        move_backward(inner->children + child + 1, inner->children + inner->count + 1,
+            inner->children + inner->count + 2);
+        inner->keys[child] = move(childSeparator);
+        inner->children[child + 1] = childSplit;
+        inner->count++;
+        if (inner->count <= kFanout) return inserted;
+
+        // The middle key moves up; the keys on either side stay as separators
+        Inner* right = newInner();
+        size_t middle = inner->count / 2;
+        right->count = inner->count - middle - 1;
+        move(inner->keys + middle + 1, inner->keys + inner->count, right->keys);
+        copy(inner->children + middle + 1, inner->children + inner->count + 1, right->children);
+        separator = move(inner->keys[middle]);
+        inner->count = middle;
+        split = right;
+        return inserted;
+    }
+
+    const Leaf* leafFor(const Key& key) const {
+        const BNode* node = root;
+        while (node != nullptr && !node->leaf) {
+            const Inner* inner = static_cast<const Inner*>(node);
+            node = inner->children[childIndex(inner, key)];
+        }
+        return static_cast<const Leaf*>(node);
+    }
+
+public:
+    static constexpr bool kOrdered = true;
+
+    BTreeStorage() = default;
+    ~BTreeStorage() { destroy(root); }
+
+    BTreeStorage(const BTreeStorage&) = delete;
+    BTreeStorage& operator=(const BTreeStorage&) = delete;
+
+    // Sorted input always goes to the rightmost leaf, so each insert is O(log n)
+    void Assign(vector<pair<Key, Value>>&& sorted) {
+        destroy(root);
+        root = nullptr;
+        size = 0;
+        for (auto& entry : sorted) Insert(entry.first, move(entry.second));
+    }
+
+    bool Insert(const Key& key, Value value) {
+        if (root == nullptr) root = newLeaf();
+        Key separator;
+        BNode* split;
+        bool inserted = insert(root, key, value, separator, split);
+        if (split != nullptr) {
+            Inner* newRoot = newInner();
+            newRoot->count = 1;
+            newRoot->keys[0] = move(separator);
+            newRoot->children[0] = root;
+            newRoot->children[1] = split;
+            root = newRoot;
+        }
+        if (inserted) size++;
+        return inserted;
+    }
+
+    const Value* Find(const Key& key) const {
+        const Leaf* leaf = leafFor(key);
+        if (leaf == nullptr) return nullptr;
+        size_t at = lowerBound(leaf, key);
+        if (at == leaf->count || less(key, leaf->keys[at])) return nullptr;
+        return &leaf->values[at];
+    }
+
+    bool Erase(const Key& key) {
+        Leaf* leaf = const_cast<Leaf*>(leafFor(key));
+        if (leaf == nullptr) return false;
+        size_t at = lowerBound(leaf, key);
+        if (at == leaf->count || less(key, leaf->keys[at])) return false;
+        move(leaf->keys + at + 1, leaf->keys + leaf->count, leaf->keys + at);
+        move(leaf->values + at + 1, leaf->values + leaf->count, leaf->values + at);
+        leaf->count--;
+        size--;
+        return true;
+    }
+
+    size_t Size() const { return size; }
+
+    template <typename Visit>
+    void ForEach(const Visit& visit) const {
+        const BNode* node = root;
+        while (node != nullptr && !node->leaf) node = static_cast<const Inner*>(node)->children[0];
+        for (const Leaf* leaf = static_cast<const Leaf*>(node); leaf != nullptr; leaf = leaf->next) {
+            for (size_t i = 0; i < leaf->count; ++i) visit(leaf->keys[i], leaf->values[i]);
+        }
+    }
+};
+
+/*
+HashStorage: node-based hash map using the hashing the key ordering
+declares (see IndexHashing). Fastest point lookups, but no key order:
+ForEach visits entries in an unspecified order.
+*/
+template <typename Key, typename Value, typename Compare>
+class HashStorage {
+private:
+    using Hashing = IndexHashing<Key, Compare>;
+    unordered_map<Key, Value, typename Hashing::hash_type, typename Hashing::equal_type,
+        CatalogAllocator<pair<const Key, Value>>> entries;
+
+public:
+    static constexpr bool kOrdered = false;
+
+    void Assign(vector<pair<Key, Value>>&& sorted) {
+        entries.clear();
+        entries.reserve(sorted.size());
+        for (auto& entry : sorted) entries.emplace(move(entry.first), move(entry.second));
+    }
+
+    bool Insert(const Key& key, Value value) {
+        auto result = entries.try_emplace(key, move(value));
+        if (!result.second) result.first->second = move(value);
+        return result.second;
+    }
+
+    const Value* Find(const Key& key) const {
+        auto found = entries.find(key);
+        return found == entries.end() ? nullptr : &found->second;
+    }
+
+    bool Erase(const Key& key) { return entries.erase(key) > 0; }
+
+    size_t Size() const { return entries.size(); }
+
+    template <typename Visit>
+    void ForEach(const Visit& visit) const {
+        for (const auto& entry : entries) visit(entry.first, entry.second);
+    }
+};
+
+/*
+Index over unique keys, with the data structure chosen at compile time.
+Key and Value are the stored types, Compare a strict weak ordering of
+keys, and Storage one of the policies above. For example
+    GenericIndex<string, Course, less<string>, BTreeStorage>
+is a B+ tree of course records by course number. ForEachInOrder only
+compiles for ordered storage.
+*/
+template <typename Key, typename Value, typename Compare = less<Key>,
+    template <typename, typename, typename> class Storage = PointerTreeStorage>
+class GenericIndex {
+private:
+    Storage<Key, Value, Compare> storage;
+
+public:
+    using key_type = Key;
+    using value_type = Value;
+    using key_compare = Compare;
+    using storage_type = Storage<Key, Value, Compare>;
+    static constexpr bool kOrdered = storage_type::kOrdered;
+
+    // Replaces the contents with entries sorted by Compare and distinct
+    void Assign(vector<pair<Key, Value>>&& sorted) { storage.Assign(move(sorted)); }
+
+    bool Insert(const Key& key, Value value) { return storage.Insert(key, move(value)); }
+
+    const Value* Find(const Key& key) const { return storage.Find(key); }
+
+    bool Contains(const Key& key) const { return storage.Find(key) != nullptr; }
+
+    bool Erase(const Key& key) { return storage.Erase(key); }
+
+    size_t Size() const { return storage.Size(); }
+
+    // Visits every entry in key order
+    template <typename Visit>
+    void ForEachInOrder(const Visit& visit) const {
+        static_assert(kOrdered, "ForEachInOrder needs an ordered storage policy");
+        storage.ForEach(visit);
+    }
+
+    // Visits every entry in the order the storage keeps them
+    template <typename Visit>
+    void ForEach(const Visit& visit) const { storage.ForEach(visit); }
+};
+
+/*
+Xor filter over course key hashes with 8-bit fingerprints.
+Purpose:
+- Reject course numbers that are not in the catalog with three byte
+  reads, before any probe of the lookup table or descent of a tree
+- Use about 1.23 bytes per course for a false positive rate near 1/256
+
+Every key maps to one slot in each third of the array, and its
+fingerprint equals the XOR of those three slots. Construction peels off
+slots that only one remaining key maps to, then fills the slots in
+reverse peel order; a failed peel retries with a new seed.
+The filter is static: once keys are added it must be rebuilt, and while
+it is not current MayContain answers true for every key.
+*/
+class CourseKeyFilter {
+private:
+    vector<uint8_t, CatalogAllocator<uint8_t>> fingerprints;
+    uint32_t segmentLength;
+    uint64_t seed;
+    bool current;
+
+    static const int kMaxAttempts = 64;
+
+    uint64_t mix(uint64_t keyHash) const {
+        uint64_t h = keyHash + seed;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static uint8_t fingerprint(uint64_t h) {
+        return static_cast<uint8_t>(h ^ (h >> 32));
+    }
+
+    // Slot of a mixed hash within the given third of the array
+    uint32_t slot(uint64_t h, uint32_t segment) const {
+        uint64_t rotated = (segment == 0) ? h : (h << (21 * segment)) | (h >> (64 - 21 * segment));
+        uint64_t part = static_cast<uint32_t>(rotated);
+        return static_cast<uint32_t>((part * segmentLength) >> 32) + segment * segmentLength;
+    }
+
+public:
+    CourseKeyFilter() : segmentLength(0), seed(0), current(false) {}
+
+    /*
+    Builds the filter from the hashes of every key in the set.
+    Hashes must be distinct; if peeling keeps failing the filter is left
+    not current, which only disables the shortcut.
+    */
+    void Build(const vector<uint64_t>& keyHashes) {
+        size_t count = keyHashes.size();
+        segmentLength = static_cast<uint32_t>((count * 123 / 100 + 32) / 3 + 1);
+        size_t capacity = static_cast<size_t>(segmentLength) * 3;
+
+        vector<uint64_t> xorMask(capacity);
+        vector<uint32_t> counts(capacity);
+        vector<uint32_t> queue;
+        vector<pair<uint64_t, uint32_t>> peeled;
+        peeled.reserve(count);
+
+        for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+            seed = 0x9E3779B97F4A7C15ULL * static_cast<uint64_t>(attempt + 1);
+            fill(xorMask.begin(), xorMask.end(), 0);
+            fill(counts.begin(), counts.end(), 0);
+            for (uint64_t keyHash : keyHashes) {
+                uint64_t h = mix(keyHash);
+                for (uint32_t segment = 0; segment < 3; ++segment) {
+                    uint32_t i = slot(h, segment);
+                    xorMask[i] ^= h;
+                    counts[i]++;
+                }
+            }
+
+            queue.clear();
+            for (uint32_t i = 0; i < capacity; ++i) {
+                if (counts[i] == 1) queue.push_back(i);
+            }
+            peeled.clear();
+            while (!queue.empty()) {
+                uint32_t i = queue.back();
+                queue.pop_back();
+                if (counts[i] != 1) continue;
+
+                uint64_t h = xorMask[i];
+                peeled.emplace_back(h, i);
+                for (uint32_t segment = 0; segment < 3; ++segment) {
+                    uint32_t j = slot(h, segment);
+                    xorMask[j] ^= h;
+                    if (--counts[j] == 1) queue.push_back(j);
+                }
+            }
+            if (peeled.size() != count) continue;
+
+            fingerprints.assign(capacity, 0);
+            for (auto entry = peeled.rbegin(); entry != peeled.rend(); ++entry) {
+                uint64_t h = entry->first;
+                fingerprints[entry->second] = fingerprint(h)
+                    ^ fingerprints[slot(h, 0)] ^ fingerprints[slot(h, 1)] ^ fingerprints[slot(h, 2)];
+            }
+            current = true;
+            return;
+        }
+
+        fingerprints.clear();
+        current = false;
+    }
+
+    // Marks the filter out of date after keys were added
+    void Invalidate() { current = false; }
+
+    bool IsCurrent() const { return current; }
+
+    // False only when the key is certainly absent
+    bool MayContain(uint64_t keyHash) const {
+        if (!current) return true;
+        uint64_t h = mix(keyHash);
+        return fingerprint(h) == (fingerprints[slot(h, 0)]
+            ^ fingerprints[slot(h, 1)] ^ fingerprints[slot(h, 2)]);
+    }
+
+    size_t Bytes() const { return fingerprints.size(); }
+
+    MemoryUsage Footprint() const {
+        MemoryUsage usage;
+        usage.entries = fingerprints.size();
+        usage.used = fingerprints.size();
+        usage.slack = fingerprints.capacity() - fingerprints.size();
+        usage.allocations = fingerprints.capacity() > 0 ? 1 : 0;
+        return usage;
+    }
+
+    void ShrinkToFit() { fingerprints.shrink_to_fit(); }
+};
+
+/*
+Flat open-addressing lookup table built after a load.
+Purpose:
+- Answer course number lookups with a single contiguous slot array
+  instead of the linked buckets of unordered_map
+- Support batched lookups that overlap the cache misses of many keys
+
+Each slot stores the full key hash next to the course pointer so most
+mismatches are rejected without touching the Course record.
+An xor filter built with the table rejects most absent keys before the
+slot array is probed at all.
+Courses are owned by the hash map; the table only points into it.
+*/
+class CourseLookupTable {
+private:
+    struct Slot {
+        uint64_t hash;
+        const Course* course;   // nullptr marks an empty slot
+    };
+
+    vector<Slot, CatalogAllocator<Slot>> slots;
+    size_t mask;
+    size_t count;
+    CourseKeyFilter filter;
+    bool filterStale;   // courses were inserted after the filter was built
+
+    // Number of lookups kept in flight by FindBatch
+    static const size_t kBatchWindow = 16;
+
+    // Same word-at-a-time hash as the course map
+    static uint64_t hashKey(string_view key) {
+        return HashCourseNumber(key);
+    }
+
+    // Places a slot at the first free position of its probe run
+    void place(const Slot& slot) {
+        size_t position = slot.hash & mask;
+        while (slots[position].course != nullptr) {
+            position = (position + 1) & mask;
+        }
+        slots[position] = slot;
+    }
+
+    // Reallocates to the given power-of-two capacity and reinserts every slot
+    void resize(size_t capacity) {
+        vector<Slot, CatalogAllocator<Slot>> previous;
+        previous.swap(slots);
+        slots.assign(capacity, Slot{ 0, nullptr });
+        mask = capacity - 1;
+        for (const Slot& slot : previous) {
+            if (slot.course != nullptr) place(slot);
+        }
+    }
+
+    // Builds the filter from the hashes already stored in the slots
+    void rebuildFilter() {
+        vector<uint64_t> hashes;
+        hashes.reserve(count);
+        for (const Slot& slot : slots) {
+            if (slot.course != nullptr) hashes.push_back(slot.hash);
+        }
+        filter.Build(hashes);
+        filterStale = false;
+    }
+
+    // Smallest power-of-two capacity that keeps the table at most half full
+    static size_t capacityFor(size_t courseCount) {
+        size_t capacity = 16;
+        while (capacity < courseCount * 2) capacity <<= 1;
+        return capacity;
+    }
+
+    // Empties the table and sizes it for the given number of courses
+    void reset(size_t courseCount) {
+        size_t capacity = capacityFor(courseCount);
+
+        slots.assign(capacity, Slot{ 0, nullptr });
+        mask = capacity - 1;
+        count = courseCount;
+    }
+
+public:
+    CourseLookupTable() : mask(0), count(0), filterStale(false) {}
+
+    /*
+    Rebuilds the table from the hash map.
+    Capacity is the next power of two at or above twice the course count,
+    keeping the load factor at or below one half for short probe runs.
+    */
+    void Build(const CourseMap& courseMap) {
+        reset(courseMap.size());
+        for (const auto& pair : courseMap) {
+            place(Slot{ hashKey(pair.first), &pair.second });
+        }
+        rebuildFilter();
+    }
+
+    // Rebuilds the table over course records owned by another structure
+    void Build(const vector<const Course*>& courses) {
+        reset(courses.size());
+        for (const Course* course : courses) {
+            place(Slot{ hashKey(course->courseNumber), course });
+        }
+        rebuildFilter();
+    }
+
+    /*
+    Adds one course; the table doubles when it would exceed half full.
+    The course must not already be present. The filter stops rejecting
+    keys until RefreshFilter rebuilds it.
+    */
+    void Insert(const Course* course) {
+        if ((count + 1) * 2 > slots.size()) {
+            resize(slots.empty() ? 16 : slots.size() * 2);
+        }
+        place(Slot{ hashKey(course->courseNumber), course });
+        count++;
+        filter.Invalidate();
+        filterStale = true;
+    }
+
+    /*
+    Rebuilds the filter if courses were inserted since it was built.
+    Called lazily before lookups so a run of edits costs one O(n) rebuild.
+    Removed courses need no rebuild: they only become false positives.
+    */
+    void RefreshFilter() {
+        if (filterStale) rebuildFilter();
+    }
+
+    /*
+    Shrinks the slot array back to the build-time capacity after many
+    removals and rebuilds a stale filter. Courses keep their addresses.
+    */
+    void Compact() {
+        if (slots.empty()) return;
+        size_t capacity = capacityFor(count);
+        if (capacity < slots.size()) resize(capacity);
+        RefreshFilter();
+        filter.ShrinkToFit();
+    }
+
+    // Slots holding courses count as used; the empty half kept for short probes is slack
+    MemoryUsage Footprint() const {
+        MemoryUsage usage;
+        usage.entries = count;
+        usage.used = count * sizeof(Slot);
+        usage.slack = (slots.capacity() - count) * sizeof(Slot);
+        usage.allocations = slots.capacity() > 0 ? 1 : 0;
+        return usage;
+    }
+
+    MemoryUsage FilterFootprint() const { return filter.Footprint(); }
+
+    // False when the course number is certainly not in the table
+    bool MayContain(string_view courseNumber) const {
+        return filter.MayContain(hashKey(courseNumber));
+    }
+
+    /*
+    Removes one course using backward-shift deletion: later entries of
+    the same probe run move back into the hole, so no tombstones are
+    left behind and lookups never probe past deleted slots.
+    */
+    bool Erase(string_view courseNumber) {
+        if (slots.empty()) return false;
+
+        uint64_t hash = hashKey(courseNumber);
+        size_t hole = hash & mask;
+        while (true) {
+            const Slot& slot = slots[hole];
+            if (slot.course == nullptr) return false;
+            if (slot.hash == hash && slot.course->courseNumber == courseNumber) break;
+            hole = (hole + 1) & mask;
+        }
+
+        size_t next = (hole + 1) & mask;
+        while (slots[next].course != nullptr) {
+            size_t home = slots[next].hash & mask;
+            // Move the entry back unless its home lies between the hole and itself
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        slots[hole] = Slot{ 0, nullptr };
+        count--;
+        return true;
+    }
+
+    /*
+    Single key lookup with linear probing.
+    Returns nullptr when the course number is not present.
+    */
+    const Course* Find(string_view courseNumber) const {
+        if (slots.empty()) return nullptr;
+
+        uint64_t hash = hashKey(courseNumber);
+        if (!filter.MayContain(hash)) return nullptr;
+
+        size_t position = hash & mask;
+        while (slots[position].course != nullptr) {
+            const Slot& slot = slots[position];
+            if (slot.hash == hash && slot.course->courseNumber == courseNumber) {
+                return slot.course;
+            }
+            position = (position + 1) & mask;
+        }
+        return nullptr;
+    }
+
+    /*
+    Batched lookup using asynchronous memory access chaining (AMAC).
+    All keys are hashed up front, then up to kBatchWindow lookups are kept
+    in flight: each step issues a prefetch for the memory a lookup needs
+    next and moves on to another lookup instead of waiting for the miss.
+    Keys rejected by the filter never enter the window.
+    Results are returned in the same order as the requested keys.
+    */
+    vector<const Course*> FindBatch(const vector<string>& courseNumbers) const {
+        size_t count = courseNumbers.size();
+        vector<const Course*> results(count, nullptr);
+        if (slots.empty() || count == 0) return results;
+
+        // Stage 1: hash every key so the probe loop only touches the table
+        vector<uint64_t> hashes(count);
+        for (size_t i = 0; i < count; ++i) {
+            hashes[i] = hashKey(courseNumbers[i]);
+        }
+
+        // Stage 2: interleave the probes
+        enum class Step { ProbeSlot, CompareKey, Done };
+        struct Lookup {
+            size_t keyIndex;
+            size_t position;
+            Step step;
+        };
+
+        Lookup window[kBatchWindow];
+        size_t nextKey = 0;
+        size_t active = 0;
+
+        auto start = [&](Lookup& lookup) {
+            while (nextKey < count && !filter.MayContain(hashes[nextKey])) nextKey++;
+            if (nextKey < count) {
+                lookup.keyIndex = nextKey++;
+                lookup.position = hashes[lookup.keyIndex] & mask;
+                lookup.step = Step::ProbeSlot;
+                PREFETCH(&slots[lookup.position]);
+                active++;
+            }
+            else {
+                lookup.step = Step::Done;
+            }
+        };
+
+        for (size_t i = 0; i < kBatchWindow; ++i) {
+            start(window[i]);
+        }
+
+        while (active > 0) {
+            for (size_t i = 0; i < kBatchWindow; ++i) {
+                Lookup& lookup = window[i];
+                if (lookup.step == Step::Done) continue;
+
+                const Slot& slot = slots[lookup.position];
+                if (lookup.step == Step::ProbeSlot) {
+                    if (slot.course == nullptr) {
+                        // Empty slot ends the probe run: key is absent
+                        active--;
+                        start(lookup);
+                    }
+                    else if (slot.hash == hashes[lookup.keyIndex]) {
+                        // Hash matches: fetch the course before comparing keys
+                        lookup.step = Step::CompareKey;
+                        PREFETCH(slot.course);
+                    }
+                    else {
+                        lookup.position = (lookup.position + 1) & mask;
+                        PREFETCH(&slots[lookup.position]);
+                    }
+                }
+                else {
+                    if (slot.course->courseNumber == courseNumbers[lookup.keyIndex]) {
+                        results[lookup.keyIndex] = slot.course;
+                        active--;
+                        start(lookup);
+                    }
+                    else {
+                        lookup.step = Step::ProbeSlot;
+                        lookup.position = (lookup.position + 1) & mask;
+                        PREFETCH(&slots[lookup.position]);
+                    }
+                }
+            }
+        }
+        return results;
+    }
+};
+
+/*
+Groups the structures that together make up the loaded catalog.
+The hash map owns the course records and the flat table points into
+the map; every load builds both because lookups need nothing else.
+The BST (sorted order) and the reverse index (course number to the
+courses that list it as a prerequisite) are derived from the map on
+first use through Ordered() and Dependents(), or in the background
+right after a load, so a session that only looks courses up never
+pays for them. Once built they are kept current by every edit.
+Edits go through the catalog functions below so these never disagree;
+they hold indexLock, which also serializes a background build.
+*/
+struct CourseCatalog {
+    CourseMap courseMap;
+    CourseLookupTable lookupTable;
+    uint64_t revision = 0;   // bumped on every change so derived data can detect staleness
+
+    // Derived structures, valid only while their flag is set
+    mutable CourseBST orderedCache;
+    mutable unordered_map<string, vector<string>> dependentsCache;
+    mutable atomic<bool> orderedBuilt{ false };
+    mutable atomic<bool> dependentsBuilt{ false };
+    mutable mutex indexLock;
+
+    /*
+    Sorted index of every course, built on first use.
+    Built balanced from the sorted records, so sorted input files no
+    longer produce a degenerate tree; later edits insert as before.
+    */
+    const CourseBST& Ordered() const {
+        if (!orderedBuilt.load(memory_order_acquire)) {
+            lock_guard<mutex> guard(indexLock);
+            if (!orderedBuilt.load(memory_order_relaxed)) {
+                // Parse every key once rather than twice per comparison
+                vector<pair<CourseKey, const Course*>> keyed;
+                keyed.reserve(courseMap.size());
+                for (const auto& pair : courseMap) {
+                    keyed.emplace_back(CourseKey::Parse(pair.first), &pair.second);
+                }
+                sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) {
+                    return CompareCourseKeys(a.first, a.second->courseNumber,
+                        b.first, b.second->courseNumber) < 0;
+                });
+                vector<const Course*> sorted;
+                sorted.reserve(keyed.size());
+                for (const auto& entry : keyed) sorted.push_back(entry.second);
+                orderedCache.BuildBalanced(sorted);
+                orderedBuilt.store(true, memory_order_release);
+            }
+        }
+        return orderedCache;
+    }
+
+    // Courses listing each course number as a prerequisite, built on first use
+    const unordered_map<string, vector<string>>& Dependents() const {
+        if (!dependentsBuilt.load(memory_order_acquire)) {
+            lock_guard<mutex> guard(indexLock);
+            if (!dependentsBuilt.load(memory_order_relaxed)) {
+                dependentsCache.clear();
+                for (const auto& pair : courseMap) {
+                    for (const auto& prereq : pair.second.prerequisites) {
+                        dependentsCache[prereq].push_back(pair.first);
+                    }
+                }
+                dependentsBuilt.store(true, memory_order_release);
+            }
+        }
+        return dependentsCache;
+    }
+
+    // Drops both derived structures; call with indexLock held
+    void InvalidateDerived() {
+        orderedBuilt = false;
+        dependentsBuilt = false;
+        orderedCache.Clear();
+        dependentsCache.clear();
+    }
+};
+
+// Longest course number accepted by the allocation-free lookup path
+const size_t kMaxCourseKeyLength = 32;
+
+/*
+Converts ASCII lowercase letters to uppercase in place.
+With SSE2 the letters are found 16 bytes at a time: shifting every byte
+by 0x80 - 'a' moves 'a'..'z' to the bottom of the signed range (-128 to
+-103), so one signed compare against -102 builds a mask of lowercase
+bytes and 0x20 is subtracted from exactly those bytes.
+Non-ASCII bytes are never modified.
+*/
+void UppercaseAscii(char* data, size_t length) {
+    size_t i = 0;
+#ifdef COURSE_PLANNER_SSE2
+    const __m128i shift = _mm_set1_epi8(static_cast<char>(0x80 - 'a'));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(0x80 + 26));
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i isLower = _mm_cmplt_epi8(_mm_add_epi8(bytes, shift), limit);
+        bytes = _mm_sub_epi8(bytes, _mm_and_si128(isLower, caseBit));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), bytes);
+    }
+#endif
+    for (; i < length; ++i) {
+        if (data[i] >= 'a' && data[i] <= 'z') data[i] -= 'a' - 'A';
+    }
+}
+
+// Spaces, tabs and the carriage return left behind by CRLF files
+inline bool IsKeyWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Returns the key without leading or trailing whitespace
+string_view TrimKeyWhitespace(string_view key) {
+    size_t first = 0;
+    size_t last = key.size();
+    while (first < last && IsKeyWhitespace(key[first])) ++first;
+    while (last > first && IsKeyWhitespace(key[last - 1])) --last;
+    return key.substr(first, last - first);
+}
+
+/*
+Canonicalizes a course number stored in the catalog (trim + uppercase).
+Done once per key at load so stored keys and queries always agree.
+*/
+void CanonicalizeCourseKey(string& key) {
+    string_view trimmed = TrimKeyWhitespace(key);
+    if (trimmed.size() != key.size()) {
+        key = string(trimmed);
+    }
+    UppercaseAscii(&key[0], key.size());
+}
+
+/*
+Normalizes user input into a caller-provided buffer without allocating.
+Returns the normalized length, or 0 when the input is empty or longer
+than the buffer (such input can never match a stored course number).
+*/
+size_t NormalizeCourseKey(string_view input, char* buffer, size_t capacity) {
+    string_view trimmed = TrimKeyWhitespace(input);
+    if (trimmed.empty() || trimmed.size() > capacity) return 0;
+
+    copy(trimmed.begin(), trimmed.end(), buffer);
+    UppercaseAscii(buffer, trimmed.size());
+    return trimmed.size();
+}
+
+class TaskGroup;
+
+/*
+Work-stealing task scheduler shared by every parallel stage of the planner.
+Purpose:
+- Own a single pool of worker threads so loading, validation and later
+  analytics never create competing thread pools of their own
+- Each worker owns a deque: it pushes and pops its own work at the back
+  (most recent task, still warm in cache) while idle workers steal from
+  the front of other deques (oldest task, usually the largest chunk)
+
+Fork/join work is expressed with TaskGroup, and ParallelFor splits an
+index range in halves so that stolen tasks carry large amounts of work.
+*/
+class TaskScheduler {
+private:
+    struct WorkerQueue {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<WorkerQueue>> queues;
+    vector<thread> workers;
+    mutex sleepLock;
+    condition_variable wakeUp;
+    atomic<size_t> queuedTasks;
+    atomic<size_t> nextExternalQueue;
+    bool stopping;
+
+    // Identifies the calling thread when it belongs to this scheduler
+    static thread_local TaskScheduler* currentScheduler;
+    static thread_local int currentWorker;
+
+    /*
+    Removes one task for the given worker.
+    The worker's own deque is checked first (LIFO); when it is empty the
+    other deques are scanned and a task is stolen from the front (FIFO).
+    Threads outside the pool pass a negative index and only steal.
+    */
+    bool takeTask(int self, function<void()>& task) {
+        size_t count = queues.size();
+        if (self >= 0) {
+            WorkerQueue& own = *queues[self];
+            lock_guard<mutex> guard(own.lock);
+            if (!own.tasks.empty()) {
+                task = move(own.tasks.back());
+                own.tasks.pop_back();
+                queuedTasks--;
+                return true;
+            }
+        }
+
+        size_t start = (self >= 0) ? static_cast<size_t>(self) + 1 : 0;
+        for (size_t i = 0; i < count; ++i) {
+            WorkerQueue& victim = *queues[(start + i) % count];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queuedTasks--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(int index, bool pinWorker) {
+        currentScheduler = this;
+        currentWorker = index;
+
+#ifdef __linux__
+        // Optional pinning keeps each worker on one core so its deque stays cache local
+        if (pinWorker) {
+            unsigned cores = thread::hardware_concurrency();
+            if (cores > 0) {
+                cpu_set_t cpus;
+                CPU_ZERO(&cpus);
+                CPU_SET(static_cast<unsigned>(index) % cores, &cpus);
+                pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+            }
+        }
+#else
+        (void)pinWorker;
+#endif
+
+        function<void()> task;
+        while (true) {
+            if (takeTask(index, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            unique_lock<mutex> guard(sleepLock);
+            wakeUp.wait(guard, [this] { return stopping || queuedTasks > 0; });
+            if (stopping && queuedTasks == 0) return;
+        }
+    }
+
+    template <typename Body>
+    void splitRange(TaskGroup& group, size_t begin, size_t end,
+        size_t grain, const Body& body);
+
+public:
+    /*
+    Starts the worker threads.
+    A worker count of zero uses one worker per hardware thread.
+    */
+    explicit TaskScheduler(unsigned workerCount = 0, bool pinWorkers = false)
+        : queuedTasks(0), nextExternalQueue(0), stopping(false) {
+        if (workerCount == 0) workerCount = thread::hardware_concurrency();
+        if (workerCount == 0) workerCount = 1;
+
+        for (unsigned i = 0; i < workerCount; ++i) {
+            queues.push_back(make_unique<WorkerQueue>());
+        }
+        for (unsigned i = 0; i < workerCount; ++i) {
+            workers.emplace_back(&TaskScheduler::workerLoop, this,
+                static_cast<int>(i), pinWorkers);
+        }
+    }
+
+    // Lets queued work finish, then joins every worker
+    ~TaskScheduler() {
+        {
+            lock_guard<mutex> guard(sleepLock);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    size_t WorkerCount() const { return workers.size(); }
+
+    /*
+    Queues a task.
+    Tasks created by a worker go to that worker's own deque; tasks
+    created by outside threads are spread round robin across the deques.
+    */
+    void Submit(function<void()> task) {
+        size_t target;
+        if (currentScheduler == this && currentWorker >= 0) {
+            target = static_cast<size_t>(currentWorker);
+        }
+        else {
+            target = nextExternalQueue++ % queues.size();
+        }
+
+        {
+            lock_guard<mutex> guard(queues[target]->lock);
+            queues[target]->tasks.push_back(move(task));
+            queuedTasks++;
+        }
+        {
+            // Taking the sleep lock prevents a lost wake-up between check and wait
+            lock_guard<mutex> guard(sleepLock);
+        }
+        wakeUp.notify_one();
+    }
+
+    /*
+    Blocks until done() holds or a task is queued; returns done().
+    done() is checked under the sleep lock, so a change made through
+    NotifyWaiters cannot be missed, and neither can a Submit.
+    */
+    template <typename Done>
+    bool WaitForWorkOr(const Done& done) {
+        unique_lock<mutex> guard(sleepLock);
+        wakeUp.wait(guard, [&] { return done() || queuedTasks > 0; });
+        return done();
+    }
+
+    // Applies change under the sleep lock and wakes every waiting thread
+    template <typename Change>
+    void NotifyWaiters(const Change& change) {
+        lock_guard<mutex> guard(sleepLock);
+        change();
+        wakeUp.notify_all();
+    }
+
+    /*
+    Runs one queued task on the calling thread if any is available.
+    Used by TaskGroup::Wait so a waiting thread helps instead of blocking.
+    */
+    bool RunPendingTask() {
+        int self = (currentScheduler == this) ? currentWorker : -1;
+        function<void()> task;
+        if (!takeTask(self, task)) return false;
+        task();
+        return true;
+    }
+
+    /*
+    Calls body(begin, end) over disjoint sub-ranges of [begin, end) in parallel.
+    Ranges are halved until they hold at most grain items.
+    Returns only after every sub-range has been processed.
+    */
+    template <typename Body>
+    void ParallelFor(size_t begin, size_t end, size_t grain, const Body& body);
+};
+
+thread_local TaskScheduler* TaskScheduler::currentScheduler = nullptr;
+thread_local int TaskScheduler::currentWorker = -1;
+
+/*
+Fork/join helper.
+Run() forks a task onto the scheduler and Wait() joins all forked tasks.
+While waiting, the calling thread runs queued tasks itself, so nested
+fork/join cannot deadlock; with nothing to run it sleeps until a task
+is queued or the group finishes. The first exception thrown by a task
+is rethrown by Wait().
+*/
+class TaskGroup {
+private:
+    TaskScheduler& scheduler;
+    atomic<size_t> pending;
+    mutex failureLock;
+    exception_ptr failure;
+
+    /*
+    Marks one task finished even when it throws.
+    Only the last task takes the sleep lock and wakes the waiters; the
+    others leave the group untouched once their decrement is done.
+    */
+    struct FinishGuard {
+        TaskGroup& group;
+        ~FinishGuard() {
+            size_t left = group.pending.load();
+            while (left > 1 && !group.pending.compare_exchange_weak(left, left - 1)) {}
+            if (left > 1) return;
+            group.scheduler.NotifyWaiters([this] { group.pending--; });
+        }
+    };
+
+    // Returns once every task has finished. The last check is made under
+    // the sleep lock, so a finishing task no longer touches the group.
+    void join() {
+        while (true) {
+            if (pending > 0 && scheduler.RunPendingTask()) continue;
+            if (scheduler.WaitForWorkOr([this] { return pending == 0; })) return;
+        }
+    }
+
+public:
+    explicit TaskGroup(TaskScheduler& owner) : scheduler(owner), pending(0) {}
+
+    // Joins without rethrowing; call Wait() to see task failures
+    ~TaskGroup() { join(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void Run(function<void()> task) {
+        pending++;
+        scheduler.Submit([this, task = move(task)]() {
+            FinishGuard finished{ *this };
+            try {
+                task();
+            }
+            catch (...) {
+                lock_guard<mutex> guard(failureLock);
+                if (!failure) failure = current_exception();
+            }
+        });
+    }
+
+    void Wait() {
+        join();
+        exception_ptr thrown;
+        {
+            lock_guard<mutex> guard(failureLock);
+            swap(thrown, failure);
+        }
+        if (thrown) rethrow_exception(thrown);
+    }
+};
+
+template <typename Body>
+void TaskScheduler::splitRange(TaskGroup& group, size_t begin, size_t end,
+    size_t grain, const Body& body) {
+    while (end - begin > grain) {
+        size_t middle = begin + (end - begin) / 2;
+        group.Run([this, &group, middle, end, grain, &body]() {
+            splitRange(group, middle, end, grain, body);
+        });
+        end = middle;
+    }
+    body(begin, end);
+}
+
+template <typename Body>
+void TaskScheduler::ParallelFor(size_t begin, size_t end, size_t grain, const Body& body) {
+    if (begin >= end) return;
+    if (grain == 0) grain = 1;
+    TaskGroup group(*this);
+    splitRange(group, begin, end, grain, body);
+    group.Wait();
+}
+
+// Index of the lowest set bit of a nonzero mask
+inline unsigned LowestSetBit(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    return static_cast<unsigned>(bitset<64>((mask & (0 - mask)) - 1).count());
+#endif
+}
+
+// Bit i is set when byte i of a block of up to 64 CSV bytes is a quote or a comma
+struct CsvBlockMasks {
+    uint64_t quotes;
+    uint64_t commas;
+};
+
+/*
+Finds the quotes and commas in up to 64 bytes.
+With SSE2 each 16 bytes cost two compares and two movemasks; the tail
+is classified a byte at a time without branches.
+*/
+CsvBlockMasks ClassifyCsvBlock(const char* data, size_t length) {
+    CsvBlockMasks masks{ 0, 0 };
+    size_t i = 0;
+#ifdef COURSE_PLANNER_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i comma = _mm_set1_epi8(',');
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        masks.quotes |= uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote)))) << i;
+        masks.commas |= uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, comma)))) << i;
+    }
+#endif
+    for (; i < length; ++i) {
+        masks.quotes |= uint64_t(data[i] == '"') << i;
+        masks.commas |= uint64_t(data[i] == ',') << i;
+    }
+    return masks;
+}
+
+/*
+Prefix XOR of a quote mask: bit i is set when an odd number of quotes
+appear at or before byte i, which marks the bytes inside quoted fields
+(an opening quote counts as inside, a closing one as outside).
+A carry-less multiply by all ones computes it in one instruction where
+PCLMULQDQ is enabled; otherwise six shift-XOR steps do the same.
+*/
+inline uint64_t QuotePrefixXor(uint64_t quotes) {
+#ifdef COURSE_PLANNER_CLMUL
+    __m128i product = _mm_clmulepi64_si128(
+        _mm_set_epi64x(0, static_cast<int64_t>(quotes)), _mm_set1_epi8(-1), 0);
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(product));
+#else
+    quotes ^= quotes << 1;
+    quotes ^= quotes << 2;
+    quotes ^= quotes << 4;
+    quotes ^= quotes << 8;
+    quotes ^= quotes << 16;
+    quotes ^= quotes << 32;
+    return quotes;
+#endif
+}
+
+// Strips the enclosing quotes of a field and unescapes doubled quotes
+string_view UnquoteCsvField(string_view field, string& scratch) {
+    if (field.empty() || memchr(field.data(), '"', field.size()) == nullptr) return field;
+    scratch.clear();
+    bool quoted = false;
+    for (size_t i = 0; i < field.size(); ++i) {
+        if (field[i] != '"') {
+            scratch += field[i];
+        }
+        else if (quoted && i + 1 < field.size() && field[i + 1] == '"') {
+            scratch += '"';
+            ++i;
+        }
+        else {
+            quoted = !quoted;
+        }
+    }
+    return scratch;
+}
+
+/*
+Splits one CSV record into fields per RFC 4180 and calls visit(field)
+for each, in order. A field may be enclosed in double quotes; inside
+them commas and line breaks are literal and "" is an escaped quote.
+The record is scanned 64 bytes at a time: separators are the comma bits
+outside the quote mask's prefix XOR, and an open quote carries into the
+next block as an all-ones mask, so finding fields has no per-byte branch.
+Only fields that contain a quote are copied to be unescaped.
+*/
+template <typename Visit>
+void SplitCsvRecord(string_view record, const Visit& visit) {
+    string scratch;
+    size_t fieldStart = 0;
+    uint64_t carry = 0;   // all ones while a quoted field continues into the block
+    for (size_t block = 0; block < record.size(); block += 64) {
+        size_t length = min<size_t>(64, record.size() - block);
+        CsvBlockMasks masks = ClassifyCsvBlock(record.data() + block, length);
+        uint64_t inside = QuotePrefixXor(masks.quotes) ^ carry;
+        carry = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+        for (uint64_t separators = masks.commas & ~inside; separators != 0;
+            separators &= separators - 1) {
+            size_t position = block + LowestSetBit(separators);
+            visit(UnquoteCsvField(record.substr(fieldStart, position - fieldStart), scratch));
+            fieldStart = position + 1;
+        }
+    }
+    visit(UnquoteCsvField(record.substr(fieldStart), scratch));
+}
+
+/*
+Returns the offset of the first byte that does not belong to a
+well-formed UTF-8 sequence, or npos when all of text is valid.
+Overlong forms, surrogates and code points above U+10FFFF are rejected.
+Runs of ASCII are accepted 16 bytes per SSE2 load and movemask, then 8
+bytes per word test, so mostly-ASCII catalogs validate at memory speed;
+a multi-byte sequence is checked against its lead byte's ranges.
+*/
+size_t FindInvalidUtf8(string_view text) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text.data());
+    size_t size = text.size();
+    size_t i = 0;
+    while (i < size) {
+#ifdef COURSE_PLANNER_SSE2
+        while (i + 16 <= size
+            && _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i))) == 0) {
+            i += 16;
+        }
+#endif
+        while (i + 8 <= size && (LoadWord64(text.data() + i) & 0x8080808080808080ULL) == 0) {
+            i += 8;
+        }
+        if (i == size) break;
+        unsigned char lead = bytes[i];
+        if (lead < 0x80) {
+            ++i;
+            continue;
+        }
+
+        // Range of the second byte, which is where the special cases differ
+        size_t length = 0;
+        unsigned char low = 0x80;
+        unsigned char high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) length = 2;
+        else if (lead == 0xE0) { length = 3; low = 0xA0; }         // no overlong forms
+        else if (lead == 0xED) { length = 3; high = 0x9F; }        // no surrogates
+        else if (lead >= 0xE1 && lead <= 0xEF) length = 3;
+        else if (lead == 0xF0) { length = 4; low = 0x90; }         // no overlong forms
+        else if (lead >= 0xF1 && lead <= 0xF3) length = 4;
+        else if (lead == 0xF4) { length = 4; high = 0x8F; }        // up to U+10FFFF
+        else return i;
+
+        if (size - i < length || bytes[i + 1] < low || bytes[i + 1] > high) return i;
+        for (size_t k = 2; k < length; ++k) {
+            if ((bytes[i + k] & 0xC0) != 0x80) return i;
+        }
+        i += length;
+    }
+    return string_view::npos;
+}
+
+// Where a raw CSV record starts in its file
+struct CsvPosition {
+    uint64_t offset = 0;   // bytes from the start of the file
+    uint64_t line = 1;     // physical line number
+};
+
+// Marker some Windows tools write at the start of UTF-8 files
+const string_view kUtf8ByteOrderMark = "\xEF\xBB\xBF";
+
+/*
+Reads CSV records from a stream and tracks where each one starts.
+A record spans several lines while a quoted field is still open, so a
+title with a line break stays one record. Line endings are normalized
+as records are read: the carriage return that getline leaves from a
+CRLF file is dropped from every line, and a UTF-8 byte order mark at
+the start of the file is skipped.
+*/
+class CsvRecordReader {
+private:
+    istream& input;
+    CsvPosition next;
+    string continuation;
+
+    // Reads one physical line without its line ending
+    bool readLine(string& line) {
+        if (!getline(input, line)) return false;
+        next.offset += line.size() + 1;
+        next.line++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        return true;
+    }
+
+public:
+    explicit CsvRecordReader(istream& stream) : input(stream) {}
+
+    // Reads the next record and where it starts; returns false at end of input
+    bool Read(string& record, CsvPosition& start) {
+        start = next;
+        if (!readLine(record)) return false;
+        if (start.offset == 0 && record.compare(0, kUtf8ByteOrderMark.size(), kUtf8ByteOrderMark) == 0) {
+            record.erase(0, kUtf8ByteOrderMark.size());
+            start.offset += kUtf8ByteOrderMark.size();
+        }
+
+        size_t quotes = count(record.begin(), record.end(), '"');
+        while ((quotes & 1) != 0 && readLine(continuation)) {
+            quotes += count(continuation.begin(), continuation.end(), '"');
+            record += '\n';
+            record += continuation;
+        }
+        return true;
+    }
+};
+
+/*
+Parses one CSV record into a Course.
+Format: course number, course title, then zero or more prerequisites;
+any field may be quoted, so titles can contain commas.
+Course numbers and prerequisites are stored in canonical form.
+Kept free of shared state so lines can be parsed on any worker thread.
+*/
+Course ParseCourseLine(const string& line) {
+    Course course;
+    size_t field = 0;
+
+    SplitCsvRecord(line, [&](string_view text) {
+        if (field == 0) {
+            course.courseNumber.assign(text.data(), text.size());
+            CanonicalizeCourseKey(course.courseNumber);
+        }
+        else if (field == 1) {
+            course.courseTitle.assign(text.data(), text.size());
+        }
+        else {
+            // Parse prerequisite list
+            string token(text);
+            CanonicalizeCourseKey(token);
+            if (!token.empty()) {
+                course.prerequisites.push_back(move(token));
+            }
+        }
+        field++;
+    });
+    return course;
+}
+
+// A raw record left out of a load, with where and why
+struct CsvRowIssue {
+    CsvPosition position;   // start of the record
+    uint64_t byte;          // file offset of the offending byte
+    const char* problem;
+};
+
+/*
+Checks and parses a batch of raw records in parallel.
+Records with invalid UTF-8 or a quoted field that never closes are left
+out of courses and described in issues instead; both stay in file order.
+positions[i] is where records[i] starts, so issues carry file offsets.
+An offset inside a quoted field that spans CRLF lines is early by one
+byte per carriage return dropped before it.
+*/
+void ParseCourseRecords(const vector<string>& records, const vector<CsvPosition>& positions,
+    vector<Course>& courses, vector<CsvRowIssue>& issues, TaskScheduler& scheduler) {
+    const size_t valid = string_view::npos;
+    vector<Course> parsed(records.size());
+    vector<size_t> invalidAt(records.size(), valid);
+    vector<char> unterminated(records.size(), 0);
+    scheduler.ParallelFor(0, records.size(), 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            invalidAt[i] = FindInvalidUtf8(records[i]);
+            if (invalidAt[i] != valid) continue;
+            if ((count(records[i].begin(), records[i].end(), '"') & 1) != 0) {
+                unterminated[i] = 1;
+                continue;
+            }
+            parsed[i] = ParseCourseLine(records[i]);
+        }
+    });
+
+    courses.reserve(courses.size() + records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (invalidAt[i] != valid) {
+            issues.push_back(CsvRowIssue{ positions[i], positions[i].offset + invalidAt[i],
+                "invalid UTF-8" });
+        }
+        else if (unterminated[i]) {
+            issues.push_back(CsvRowIssue{ positions[i], positions[i].offset + records[i].size(),
+                "quoted field is not closed" });
+        }
+        else {
+            courses.push_back(move(parsed[i]));
+        }
+    }
+}
+
+// Rows described before the rest are summarized in one line
+const size_t kMaxReportedIssues = 20;
+
+// Prints the rows a load skipped, each with its line and byte offset
+void ReportMalformedRows(const string& filename, const vector<CsvRowIssue>& issues) {
+    for (size_t i = 0; i < issues.size() && i < kMaxReportedIssues; ++i) {
+        const CsvRowIssue& issue = issues[i];
+        cout << "Warning: Skipped malformed row at line " << issue.position.line
+            << " of " << filename << ": " << issue.problem << " at byte offset "
+            << issue.byte << endl;
+    }
+    if (issues.size() > kMaxReportedIssues) {
+        cout << "Warning: " << issues.size() - kMaxReportedIssues
+            << " more malformed rows skipped in " << filename << endl;
+    }
+}
+
+/*
+Reads and parses every course in a CSV file, in file order.
+Lines are checked and parsed independently in parallel on the shared
+scheduler; malformed rows are reported and skipped.
+Returns false (after reporting the error) when the file cannot be opened.
+*/
+bool ReadCourseFile(const string& filename, vector<Course>& courses, TaskScheduler& scheduler) {
+    ifstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        cout << "Error: Unable to open file " << filename << endl;
+        return false;
+    }
+
+    vector<string> lines;
+    vector<CsvPosition> positions;
+    CsvRecordReader reader(file);
+    string line;
+    CsvPosition position;
+    while (reader.Read(line, position)) {
+        if (line.empty()) continue; // Skip empty lines
+        lines.push_back(line);
+        positions.push_back(position);
+    }
+
+    file.close();
+
+    // Check and parse every line independently in parallel
+    courses.clear();
+    vector<CsvRowIssue> issues;
+    ParseCourseRecords(lines, positions, courses, issues, scheduler);
+    ReportMalformedRows(filename, issues);
+    return true;
+}
+
+/*
+Merges parsed course records into the catalog.
+Courses are stored in:
+- Hash map (and its flat table) for fast lookup, built here
+- BST for sorted traversal, built from the map on first use
+
+This hybrid approach demonstrates algorithmic trade-offs.
+
+Parsing and prerequisite validation run on the shared scheduler.
+Insertion stays sequential because the map is not thread safe, and
+file order is preserved so duplicate handling matches a serial load.
+The derived structures are dropped and rebuilt lazily; a load costs
+only the parse, the map inserts and the flat table.
+When changedCourses is given, the numbers of courses that were added or
+whose record differs from the one already loaded are appended to it.
+*/
+void MergeCourses(
+    const vector<Course>& parsed,
+    CourseCatalog& catalog,
+    TaskScheduler& scheduler,
+    vector<string>* changedCourses = nullptr
+) {
+    CourseMap& courseMap = catalog.courseMap;
+
+    // Insert into the map; a repeated course number replaces the earlier record
+    {
+        lock_guard<mutex> guard(catalog.indexLock);
+        catalog.InvalidateDerived();
+        for (const Course& course : parsed) {
+            auto found = courseMap.find(course.courseNumber);
+            if (found == courseMap.end()) {
+                courseMap.emplace(course.courseNumber, course);
+            }
+            else if (found->second != course) {
+                found->second = course;
+            }
+            else {
+                continue;
+            }
+            if (changedCourses != nullptr) changedCourses->push_back(course.courseNumber);
+        }
+    }
+
+    /*
+    Validate prerequisite references.
+    This defensive check prevents silent logical flaws
+    caused by missing or incorrect prerequisite data.
+    Workers only read the map; warnings are collected per course
+    and printed afterwards so the output order stays deterministic.
+    */
+    vector<string> warnings(parsed.size());
+    scheduler.ParallelFor(0, parsed.size(), 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            for (const auto& prereq : parsed[i].prerequisites) {
+                if (courseMap.find(prereq) == courseMap.end()) {
+                    warnings[i] += "Warning: Course " + parsed[i].courseNumber
+                        + " references missing prerequisite " + prereq + "\n";
+                }
+            }
+        }
+    });
+
+    for (const auto& warning : warnings) {
+        cout << warning;
+    }
+
+    // The flat table is rebuilt last from the final map entries
+    catalog.lookupTable.Build(courseMap);
+    catalog.revision++;
+}
+
+/*
+Loads course data from a CSV file, blocking until it is merged.
+Returns false (after reporting the error) when the file cannot be opened.
+*/
+bool LoadCourses(
+    const string& filename,
+    CourseCatalog& catalog,
+    TaskScheduler& scheduler,
+    vector<string>* changedCourses = nullptr
+) {
+    vector<Course> parsed;
+    if (!ReadCourseFile(filename, parsed, scheduler)) return false;
+    MergeCourses(parsed, catalog, scheduler, changedCourses);
+    return true;
+}
+
+/*
+Rebuilds the flat lookup table from the hash map and drops the derived
+structures. Used after bulk changes such as journal recovery; O(n).
+*/
+void RebuildIndexes(CourseCatalog& catalog) {
+    lock_guard<mutex> guard(catalog.indexLock);
+    catalog.InvalidateDerived();
+    catalog.lookupTable.Build(catalog.courseMap);
+    catalog.revision++;
+}
+
+/*
+Builds the derived structures on the scheduler right after a load, so
+they are usually ready before the first query that needs them. A query
+that arrives earlier simply waits for the build in progress.
+The group must be waited on before the catalog is destroyed.
+*/
+void BuildDerivedInBackground(const CourseCatalog& catalog, TaskGroup& group) {
+    group.Run([&catalog]() {
+        catalog.Ordered();
+        catalog.Dependents();
+    });
+}
+
+/*
+Loads a course file on its own thread so the menu stays responsive.
+Lines are read and parsed in chunks on the shared scheduler, and each
+parsed chunk is published under the lock, so lookups can be answered
+from the rows ingested so far. The catalog is untouched until the
+caller takes the finished rows and merges them; a cancelled load
+leaves it exactly as it was.
+While the file is in non-decreasing course order, the distinct courses
+seen so far are a prefix of the final sorted list, which lets a listing
+wait only for the rows it needs instead of the whole file.
+*/
+class BackgroundLoad {
+public:
+    struct Progress {
+        size_t rows = 0;
+        uint64_t bytesRead = 0;
+        uint64_t totalBytes = 0;
+        double seconds = 0.0;
+    };
+
+private:
+    static const size_t kChunkLines = 16384;
+
+    enum class State { Idle, Running, Finished };
+
+    string filename;
+    thread loader;
+    mutable mutex lock;
+    condition_variable progressed;
+    atomic<bool> cancelRequested{ false };
+    State state = State::Idle;
+    vector<Course> courses;                 // parsed rows in file order
+    unordered_map<string, size_t> latest;   // course number -> last row holding it
+    vector<size_t> sortedRows;              // one row per distinct course while in order
+    vector<CsvRowIssue> issues;             // malformed rows left out, in file order
+    bool sortedSoFar = true;
+    uint64_t bytesRead = 0;
+    uint64_t totalBytes = 0;
+    chrono::steady_clock::time_point started;
+
+    // Reads, parses and publishes one chunk at a time until EOF or cancel
+    void run(ifstream file, TaskScheduler& scheduler) {
+        CsvRecordReader reader(file);
+        vector<string> lines;
+        vector<CsvPosition> positions;
+        string line;
+        CsvPosition start;
+        while (!cancelRequested) {
+            lines.clear();
+            positions.clear();
+            while (lines.size() < kChunkLines && reader.Read(line, start)) {
+                if (line.empty()) continue; // Skip empty lines
+                lines.push_back(move(line));
+                positions.push_back(start);
+            }
+            if (lines.empty()) break;
+            streamoff position = file.tellg();
+
+            vector<Course> parsed;
+            vector<CsvRowIssue> chunkIssues;
+            ParseCourseRecords(lines, positions, parsed, chunkIssues, scheduler);
+
+            {
+                lock_guard<mutex> guard(lock);
+                issues.insert(issues.end(), chunkIssues.begin(), chunkIssues.end());
+                for (Course& course : parsed) {
+                    size_t row = courses.size();
+                    if (sortedSoFar) {
+                        if (sortedRows.empty() || CompareCourseNumbers(
+                            courses[sortedRows.back()].courseNumber, course.courseNumber) < 0) {
+                            sortedRows.push_back(row);
+                        }
+                        else if (courses[sortedRows.back()].courseNumber != course.courseNumber) {
+                            sortedSoFar = false;
+                        }
+                    }
+                    latest[course.courseNumber] = row;
+                    courses.push_back(move(course));
+                }
+                bytesRead = position < 0 ? totalBytes : static_cast<uint64_t>(position);
+            }
+            progressed.notify_all();
+        }
+
+        {
+            lock_guard<mutex> guard(lock);
+            bytesRead = totalBytes;
+            state = State::Finished;
+        }
+        progressed.notify_all();
+    }
+
+    // Prints one progress line; called with the lock held
+    void printProgress() const {
+        Progress progress = progressLocked();
+        double rate = progress.seconds > 0.0 ? progress.rows / progress.seconds : 0.0;
+        cout << "Loading " << filename << ": " << progress.rows << " rows, "
+            << static_cast<uint64_t>(rate) << " rows/sec";
+        if (progress.totalBytes > 0) {
+            cout << ", " << progress.bytesRead * 100 / progress.totalBytes << "% read";
+            if (progress.bytesRead > 0 && progress.bytesRead < progress.totalBytes) {
+                double remaining = progress.seconds
+                    * (progress.totalBytes - progress.bytesRead) / progress.bytesRead;
+                cout << ", ETA " << remaining << " s";
+            }
+        }
+        cout << endl;
+    }
+
+    Progress progressLocked() const {
+        Progress progress;
+        progress.rows = courses.size();
+        progress.bytesRead = bytesRead;
+        progress.totalBytes = totalBytes;
+        progress.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        return progress;
+    }
+
+    /*
+    Blocks until ready() holds or the load stops, printing progress about
+    twice a second. Called with the lock held through guard.
+    */
+    template <typename Ready>
+    void waitUntil(unique_lock<mutex>& guard, const Ready& ready) {
+        while (state == State::Running && !ready()) {
+            if (!progressed.wait_for(guard, chrono::milliseconds(500),
+                [&]() { return state != State::Running || ready(); })) {
+                printProgress();
+            }
+        }
+    }
+
+public:
+    BackgroundLoad() = default;
+    ~BackgroundLoad() { Cancel(); }
+
+    BackgroundLoad(const BackgroundLoad&) = delete;
+    BackgroundLoad& operator=(const BackgroundLoad&) = delete;
+
+    /*
+    Opens the file and starts loading it.
+    Returns false (after reporting the error) when the file cannot be
+    opened or another load has not been merged or cancelled yet.
+    */
+    bool Start(const string& file, TaskScheduler& scheduler) {
+        if (Pending()) {
+            cout << "Error: A load is already in progress." << endl;
+            return false;
+        }
+        ifstream input(file, ios::binary);
+        if (!input.is_open()) {
+            cout << "Error: Unable to open file " << file << endl;
+            return false;
+        }
+        error_code error;
+        uintmax_t size = filesystem::file_size(file, error);
+
+        filename = file;
+        courses.clear();
+        latest.clear();
+        sortedRows.clear();
+        issues.clear();
+        sortedSoFar = true;
+        bytesRead = 0;
+        totalBytes = error ? 0 : static_cast<uint64_t>(size);
+        cancelRequested = false;
+        started = chrono::steady_clock::now();
+        state = State::Running;
+        loader = thread([this, &scheduler](ifstream stream) { run(move(stream), scheduler); },
+            move(input));
+        return true;
+    }
+
+    // True from Start() until the rows are taken or the load is cancelled
+    bool Pending() const {
+        lock_guard<mutex> guard(lock);
+        return state != State::Idle;
+    }
+
+    // True once every row has been parsed and is waiting to be merged
+    bool Finished() const {
+        lock_guard<mutex> guard(lock);
+        return state == State::Finished;
+    }
+
+    const string& FileName() const { return filename; }
+
+    Progress GetProgress() const {
+        lock_guard<mutex> guard(lock);
+        return progressLocked();
+    }
+
+    void PrintProgress() const {
+        lock_guard<mutex> guard(lock);
+        printProgress();
+    }
+
+    /*
+    Stops a running load and discards its rows; the catalog never saw
+    them. Returns the number of rows that had been ingested.
+    */
+    size_t Cancel() {
+        cancelRequested = true;
+        if (loader.joinable()) loader.join();
+        lock_guard<mutex> guard(lock);
+        size_t rows = courses.size();
+        courses.clear();
+        latest.clear();
+        sortedRows.clear();
+        state = State::Idle;
+        return rows;
+    }
+
+    // Waits, with progress, until every row is parsed
+    void WaitUntilFinished() {
+        unique_lock<mutex> guard(lock);
+        waitUntil(guard, []() { return false; });
+    }
+
+    // Malformed rows the load skipped; complete once TakeCourses returns
+    const vector<CsvRowIssue>& Issues() const { return issues; }
+
+    /*
+    Hands the finished rows, in file order, to the caller for merging.
+    Waits for the load first if it is still running.
+    */
+    vector<Course> TakeCourses() {
+        WaitUntilFinished();
+        if (loader.joinable()) loader.join();
+        lock_guard<mutex> guard(lock);
+        vector<Course> taken = move(courses);
+        courses.clear();
+        latest.clear();
+        sortedRows.clear();
+        state = State::Idle;
+        return taken;
+    }
+
+    /*
+    Copies the latest ingested record for a canonical course number.
+    A course already read returns at once; otherwise this waits until it
+    arrives, a sorted file has passed it, or the file is finished.
+    */
+    bool WaitForCourse(const string& courseNumber, Course& course) {
+        unique_lock<mutex> guard(lock);
+        waitUntil(guard, [&]() {
+            return latest.count(courseNumber) != 0 || (sortedSoFar && !sortedRows.empty()
+                && CompareCourseNumbers(courseNumber, courses[sortedRows.back()].courseNumber) < 0);
+        });
+        auto found = latest.find(courseNumber);
+        if (found == latest.end()) return false;
+        course = courses[found->second];
+        return true;
+    }
+
+    /*
+    Prints one page of the sorted list from the rows ingested so far.
+    Input is a page number or a course number, as for PrintCoursePage.
+    Waits only until the requested page (or course) has arrived.
+    Returns false without printing when the answer cannot come from a
+    prefix: the file turned out not to be sorted, or it has finished
+    loading and the merged catalog should answer instead.
+    */
+    bool PrintSortedPage(const string& input, size_t pageSize) {
+        string_view trimmed = TrimKeyWhitespace(input);
+        bool numeric = !trimmed.empty()
+            && all_of(trimmed.begin(), trimmed.end(),
+                [](char c) { return c >= '0' && c <= '9'; });
+
+        unique_lock<mutex> guard(lock);
+        size_t first = 0;
+        if (numeric) {
+            size_t page = static_cast<size_t>(strtoull(string(trimmed).c_str(), nullptr, 10));
+            if (page == 0) {
+                cout << "Page must be at least 1." << endl;
+                return true;
+            }
+            first = (page - 1) * pageSize;
+            waitUntil(guard, [&]() {
+                return !sortedSoFar || sortedRows.size() >= first + pageSize;
+            });
+            if (!sortedSoFar || state != State::Running) return false;
+        }
+        else {
+            string courseNumber(trimmed);
+            CanonicalizeCourseKey(courseNumber);
+            auto arrived = [&]() {
+                return !sortedSoFar || (!sortedRows.empty()
+                    && CompareCourseNumbers(courses[sortedRows.back()].courseNumber, courseNumber) >= 0);
+            };
+            waitUntil(guard, arrived);
+            if (!sortedSoFar || state != State::Running) return false;
+
+            auto position = lower_bound(sortedRows.begin(), sortedRows.end(), courseNumber,
+                [&](size_t row, const string& key) {
+                    return CompareCourseNumbers(courses[row].courseNumber, key) < 0;
+                });
+            if (courses[*position].courseNumber != courseNumber) {
+                cout << "Course not found." << endl;
+                return true;
+            }
+            size_t rank = static_cast<size_t>(position - sortedRows.begin());
+            cout << courseNumber << " is course " << rank + 1
+                << " of at least " << sortedRows.size() << " (still loading)." << endl;
+            first = rank - rank % pageSize;
+        }
+
+        cout << "\nPage " << first / pageSize + 1 << " (still loading):\n" << endl;
+        size_t last = min(first + pageSize, sortedRows.size());
+        for (size_t i = first; i < last; ++i) {
+            const Course& course = courses[latest[courses[sortedRows[i]].courseNumber]];
+            cout << course.courseNumber << ", " << course.courseTitle << endl;
+        }
+        return true;
+    }
+};
+
+// Adds the reverse-index entries for a course's prerequisites
+void AddDependents(CourseCatalog& catalog, const Course& course) {
+    for (const auto& prereq : course.prerequisites) {
+        catalog.dependentsCache[prereq].push_back(course.courseNumber);
+    }
+}
+
+// Removes the reverse-index entries for a course's prerequisites
+void RemoveDependents(CourseCatalog& catalog, const Course& course) {
+    for (const auto& prereq : course.prerequisites) {
+        auto found = catalog.dependentsCache.find(prereq);
+        if (found == catalog.dependentsCache.end()) continue;
+
+        vector<string>& list = found->second;
+        auto entry = find(list.begin(), list.end(), course.courseNumber);
+        if (entry != list.end()) list.erase(entry);
+        if (list.empty()) catalog.dependentsCache.erase(found);
+    }
+}
+
+/*
+Adds a new course or replaces the course with the same number.
+A new course is inserted into every built structure; an existing record
+is replaced in place, so only its reverse-index entries change.
+Average complexity: O(log n + number of prerequisites)
+*/
+void UpsertCourse(CourseCatalog& catalog, const Course& course) {
+    lock_guard<mutex> guard(catalog.indexLock);
+    bool ordered = catalog.orderedBuilt;
+    bool dependents = catalog.dependentsBuilt;
+
+    auto found = catalog.courseMap.find(course.courseNumber);
+    if (found == catalog.courseMap.end()) {
+        auto inserted = catalog.courseMap.emplace(course.courseNumber, course).first;
+        if (ordered) catalog.orderedCache.Insert(course);
+        catalog.lookupTable.Insert(&inserted->second);
+    }
+    else {
+        if (dependents) RemoveDependents(catalog, found->second);
+        found->second = course;
+        if (ordered) catalog.orderedCache.Update(course);
+    }
+    if (dependents) AddDependents(catalog, course);
+    catalog.revision++;
+}
+
+/*
+Removes a course from every built structure.
+Courses that still list it as a prerequisite are reported, matching the
+missing-prerequisite warnings printed at load time; this needs the
+reverse index, so the first removal builds it.
+Returns false when the course is not in the catalog.
+Average complexity: O(log n + number of prerequisites)
+*/
+bool RemoveCourse(CourseCatalog& catalog, const string& courseNumber) {
+    if (catalog.courseMap.find(courseNumber) == catalog.courseMap.end()) return false;
+    catalog.Dependents();
+
+    lock_guard<mutex> guard(catalog.indexLock);
+    auto found = catalog.courseMap.find(courseNumber);
+    RemoveDependents(catalog, found->second);
+    catalog.lookupTable.Erase(courseNumber);
+    if (catalog.orderedBuilt) catalog.orderedCache.Remove(courseNumber);
+    catalog.courseMap.erase(found);
+    catalog.revision++;
+
+    auto dependents = catalog.dependentsCache.find(courseNumber);
+    if (dependents != catalog.dependentsCache.end()) {
+        for (const auto& dependent : dependents->second) {
+            cout << "Warning: Course " << dependent
+                << " references missing prerequisite " << courseNumber << endl;
+        }
+    }
+    return true;
+}
+
+/*
+Heap memory of every catalog structure, one named entry per structure.
+Structures that have not been built are reported empty.
+*/
+vector<pair<string, MemoryUsage>> CatalogMemoryBreakdown(const CourseCatalog& catalog) {
+    vector<pair<string, MemoryUsage>> breakdown;
+    breakdown.emplace_back("course map nodes", HashNodeUsage(catalog.courseMap));
+    breakdown.emplace_back("course map buckets", HashBucketUsage(catalog.courseMap));
+
+    MemoryUsage records;
+    for (const auto& pair : catalog.courseMap) {
+        AddStringUsage(pair.first, records);
+        AddCourseUsage(pair.second, records);
+    }
+    records.entries = catalog.courseMap.size();
+    breakdown.emplace_back("course strings and lists", records);
+    breakdown.emplace_back("lookup table", catalog.lookupTable.Footprint());
+    breakdown.emplace_back("lookup filter", catalog.lookupTable.FilterFootprint());
+
+    lock_guard<mutex> guard(catalog.indexLock);
+    breakdown.emplace_back("sorted index", catalog.orderedBuilt
+        ? catalog.orderedCache.Footprint() : MemoryUsage());
+
+    MemoryUsage reverse = HashNodeUsage(catalog.dependentsCache);
+    for (const auto& pair : catalog.dependentsCache) {
+        AddStringUsage(pair.first, reverse);
+        AddStringListUsage(pair.second, reverse);
+    }
+    breakdown.emplace_back("reverse index", reverse);
+    breakdown.emplace_back("reverse index buckets", HashBucketUsage(catalog.dependentsCache));
+    return breakdown;
+}
+
+// Total heap bytes, used plus slack, of every catalog structure
+size_t CatalogHeapBytes(const CourseCatalog& catalog) {
+    MemoryUsage total;
+    for (const auto& entry : CatalogMemoryBreakdown(catalog)) total.Add(entry.second);
+    return total.used + total.slack;
+}
+
+/*
+Prints the memory report.
+Node sizes come from the standard library this program was built with;
+the allocator overhead line assumes about 16 bytes of header and
+rounding per heap block, which is typical of glibc malloc.
+*/
+void PrintMemoryReport(const CourseCatalog& catalog) {
+    const size_t kAllocatorOverhead = 16;
+    auto kilobytes = [](size_t bytes) { return static_cast<double>(bytes) / 1024.0; };
+
+    MemoryUsage total;
+    cout << "\nHeap memory by structure (strings up to " << kInlineStringCapacity
+        << " characters are stored inline):\n" << endl;
+    cout << left << setw(26) << "structure" << right << setw(10) << "entries"
+        << setw(14) << "used KB" << setw(14) << "slack KB" << setw(12) << "blocks" << endl;
+    cout << fixed << setprecision(1);
+    for (const auto& entry : CatalogMemoryBreakdown(catalog)) {
+        const MemoryUsage& usage = entry.second;
+        cout << left << setw(26) << entry.first << right << setw(10) << usage.entries
+            << setw(14) << kilobytes(usage.used) << setw(14) << kilobytes(usage.slack)
+            << setw(12) << usage.allocations << endl;
+        total.Add(usage);
+    }
+    cout << left << setw(36) << "total" << right << setw(14) << kilobytes(total.used)
+        << setw(14) << kilobytes(total.slack) << setw(12) << total.allocations << endl;
+    cout << "Allocator overhead: about " << kilobytes(total.allocations * kAllocatorOverhead)
+        << " KB" << endl;
+    if (hugepages::DefaultMode() != HugePageMode::Off) {
+        const hugepages::Stats& stats = hugepages::GetStats();
+        cout << "Huge pages: " << kilobytes(stats.explicitBytes) << " KB explicit, "
+            << kilobytes(stats.transparentBytes) << " KB advised transparent, "
+            << kilobytes(hugepages::ResidentHugeBytes()) << " KB resident, "
+            << stats.fallbacks << " fallbacks" << endl;
+    }
+    cout << defaultfloat << setprecision(6);
+}
+
+/*
+Reclaims slack after a load or a long run of edits:
+- every record's strings and prerequisite list shrink to fit, so short
+  strings move back inline
+- the hash map is rehashed to the smallest bucket count for its size
+- the flat table shrinks back to its build-time capacity
+- built derived structures are dropped and rebuilt on next use,
+  balanced and without slack
+Records keep their addresses, so the flat table stays valid, but their
+strings may move; the revision is bumped for anything that kept views.
+Returns the number of heap bytes released.
+*/
+size_t CompactCatalog(CourseCatalog& catalog) {
+    size_t before = CatalogHeapBytes(catalog);
+    {
+        lock_guard<mutex> guard(catalog.indexLock);
+        for (auto& pair : catalog.courseMap) CompactCourse(pair.second);
+        catalog.courseMap.rehash(0);
+        catalog.lookupTable.Compact();
+        catalog.InvalidateDerived();
+        unordered_map<string, vector<string>>().swap(catalog.dependentsCache);
+        catalog.revision++;
+    }
+    size_t after = CatalogHeapBytes(catalog);
+    return before > after ? before - after : 0;
+}
+
+// Kinds of change recorded in the catalog journal
+enum class JournalOp : uint8_t { Upsert = 1, Remove = 2 };
+
+/*
+One logged catalog change.
+Remove records only use course.courseNumber.
+*/
+struct JournalRecord {
+    JournalOp op;
+    Course course;
+};
+
+/*
+Helpers for the binary record format shared by the journal and its
+snapshots. Every record is framed as:
+    [payload length: u32][CRC-32 of payload: u32][payload]
+and the payload is the operation byte followed by length-prefixed
+strings (course number, title, prerequisite count, prerequisites).
+Integers are written little-endian so files move between machines.
+*/
+namespace journal {
+
+    uint32_t Crc32(const char* data, size_t length) {
+        static uint32_t table[256];
+        static once_flag built;
+        call_once(built, [] {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t value = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+                }
+                table[i] = value;
+            }
+        });
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < length; ++i) {
+            crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    void PutU32(string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+
+    uint32_t GetU32(const char* data) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    // Largest record payload accepted from a peer; far above any real course
+    const uint32_t kMaxRecordBytes = 1 << 24;
+
+    void PutString(string& out, const string& text) {
+        PutU32(out, static_cast<uint32_t>(text.size()));
+        out += text;
+    }
+
+    // Appends one framed record to the output buffer
+    void EncodeRecord(string& out, const JournalRecord& record) {
+        string payload;
+        payload += static_cast<char>(record.op);
+        PutString(payload, record.course.courseNumber);
+        if (record.op == JournalOp::Upsert) {
+            PutString(payload, record.course.courseTitle);
+            PutU32(payload, static_cast<uint32_t>(record.course.prerequisites.size()));
+            for (const auto& prereq : record.course.prerequisites) {
+                PutString(payload, prereq);
+            }
+        }
+
+        PutU32(out, static_cast<uint32_t>(payload.size()));
+        PutU32(out, Crc32(payload.data(), payload.size()));
+        out += payload;
+    }
+
+    /*
+    Decodes the record starting at offset and advances offset past it.
+    Returns false for a truncated or corrupted record, which is how a
+    write torn by a crash shows up at the end of the log.
+    */
+    bool DecodeRecord(const string& data, size_t& offset, JournalRecord& record) {
+        if (data.size() - offset < 8) return false;
+        uint32_t length = GetU32(data.data() + offset);
+        uint32_t checksum = GetU32(data.data() + offset + 4);
+        if (data.size() - offset - 8 < length) return false;
+
+        const char* payload = data.data() + offset + 8;
+        if (length == 0 || Crc32(payload, length) != checksum) return false;
+
+        size_t position = 0;
+        auto readString = [&](string& text) {
+            if (length - position < 4) return false;
+            uint32_t size = GetU32(payload + position);
+            position += 4;
+            if (length - position < size) return false;
+            text.assign(payload + position, size);
+            position += size;
+            return true;
+        };
+
+        record = JournalRecord();
+        record.op = static_cast<JournalOp>(payload[position++]);
+        if (!readString(record.course.courseNumber)) return false;
+
+        if (record.op == JournalOp::Upsert) {
+            if (!readString(record.course.courseTitle)) return false;
+            if (length - position < 4) return false;
+            uint32_t count = GetU32(payload + position);
+            position += 4;
+            for (uint32_t i = 0; i < count; ++i) {
+                string prereq;
+                if (!readString(prereq)) return false;
+                record.course.prerequisites.push_back(move(prereq));
+            }
+        }
+        else if (record.op != JournalOp::Remove) {
+            return false;
+        }
+
+        offset += 8 + length;
+        return true;
+    }
+
+    // Reads a whole file into memory; a missing file reads as empty
+    string ReadFile(const string& path) {
+        ifstream file(path, ios::binary);
+        if (!file.is_open()) return string();
+        ostringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+
+    // Syncs the directory holding path so a rename inside it survives a crash
+    bool SyncDirectory(const string& path) {
+#ifdef _WIN32
+        (void)path;   // NTFS journals the rename itself
+        return true;
+#else
+        string directory = filesystem::path(path).parent_path().string();
+        int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        bool synced = fsync(fd) == 0;
+        close(fd);
+        return synced;
+#endif
+    }
+
+}  // namespace journal
+
+#ifndef _WIN32
+/*
+Minimal blocking socket helpers for sharded serving and replication.
+An address is either unix:/path/to/socket or host:port (TCP).
+*/
+namespace net {
+
+    /*
+    Opens a listening or connected stream socket for an address.
+    Listening on a Unix socket replaces a stale socket file.
+    Returns -1 when the address is invalid or the socket cannot be opened.
+    */
+    int OpenSocket(const string& address, bool listening) {
+        if (address.compare(0, 5, "unix:") == 0) {
+            string path = address.substr(5);
+            sockaddr_un local;
+            memset(&local, 0, sizeof(local));
+            local.sun_family = AF_UNIX;
+            if (path.empty() || path.size() >= sizeof(local.sun_path)) return -1;
+            memcpy(local.sun_path, path.c_str(), path.size() + 1);
+
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0) return -1;
+            bool ok;
+            if (listening) {
+                unlink(path.c_str());
+                ok = ::bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0
+                    && listen(fd, 64) == 0;
+            }
+            else {
+                ok = connect(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0;
+            }
+            if (!ok) {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        size_t colon = address.rfind(':');
+        if (colon == string::npos) return -1;
+        string host = address.substr(0, colon);
+        string port = address.substr(colon + 1);
+
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (listening) hints.ai_flags = AI_PASSIVE;
+        addrinfo* results = nullptr;
+        if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &results) != 0) {
+            return -1;
+        }
+
+        int fd = -1;
+        for (addrinfo* candidate = results; candidate != nullptr; candidate = candidate->ai_next) {
+            fd = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+            if (fd < 0) continue;
+            bool ok;
+            if (listening) {
+                int reuse = 1;
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+                ok = ::bind(fd, candidate->ai_addr, candidate->ai_addrlen) == 0
+                    && listen(fd, 64) == 0;
+            }
+            else {
+                ok = connect(fd, candidate->ai_addr, candidate->ai_addrlen) == 0;
+                int noDelay = 1;
+                if (ok) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            }
+            if (ok) break;
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(results);
+        return fd;
+    }
+
+    /*
+    Limits how long one read or write on a socket may block, so a peer
+    that stops reading or answering fails the call instead of hanging it.
+    Zero leaves that direction unbounded.
+    */
+    bool SetTimeouts(int fd, int receiveMs, int sendMs) {
+        timeval receive{ receiveMs / 1000, (receiveMs % 1000) * 1000 };
+        timeval send{ sendMs / 1000, (sendMs % 1000) * 1000 };
+        return setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &receive, sizeof(receive)) == 0
+            && setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send, sizeof(send)) == 0;
+    }
+
+    /*
+    Accepts one connection. Returns -1 on failure and sets closed when the
+    listener itself is unusable (shut down or invalid). Other failures,
+    such as running out of descriptors, wait briefly before returning so
+    a caller that simply retries does not spin.
+    */
+    int Accept(int listener, bool& closed) {
+        closed = false;
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd >= 0) return fd;
+        int error = errno;
+        if (error == EINVAL || error == EBADF || error == ENOTSOCK) {
+            closed = true;
+        }
+        else if (error != EINTR && error != ECONNABORTED) {
+            this_thread::sleep_for(chrono::milliseconds(100));
+        }
+        return -1;
+    }
+
+    /*
+    Buffered reads and whole-buffer writes on one connected socket.
+    The connection owns the descriptor and closes it when destroyed.
+    */
+    class Connection {
+    private:
+        int fd;
+        string buffer;
+        size_t start;
+
+        // Reads whatever the peer has sent; false on end of stream or error
+        bool fill() {
+            char chunk[1 << 16];
+            ssize_t received = read(fd, chunk, sizeof(chunk));
+            if (received <= 0) return false;
+            buffer.erase(0, start);
+            start = 0;
+            buffer.append(chunk, static_cast<size_t>(received));
+            return true;
+        }
+
+    public:
+        explicit Connection(int socketFd) : fd(socketFd), start(0) {}
+
+        ~Connection() {
+            if (fd >= 0) close(fd);
+        }
+
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        bool WriteAll(const string& data) {
+            size_t sent = 0;
+            while (sent < data.size()) {
+                ssize_t written = write(fd, data.data() + sent, data.size() - sent);
+                if (written < 0 && errno == EINTR) continue;
+                if (written <= 0) return false;
+                sent += static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+        // Reads one line without its line break
+        bool ReadLine(string& line) {
+            while (true) {
+                size_t newline = buffer.find('\n', start);
+                if (newline != string::npos) {
+                    line.assign(buffer, start, newline - start);
+                    start = newline + 1;
+                    return true;
+                }
+                if (!fill()) return false;
+            }
+        }
+
+        // Appends exactly length bytes to out
+        bool ReadExact(size_t length, string& out) {
+            while (buffer.size() - start < length) {
+                if (!fill()) return false;
+            }
+            out.append(buffer, start, length);
+            start += length;
+            return true;
+        }
+    };
+
+}  // namespace net
+
+/*
+Reads one record batch: a record count (u32) followed by that many
+journal-format records. Used for shard replies and the replication
+stream. Returns false when the connection ends or a record is corrupt.
+The count and lengths come from the peer, so nothing is reserved from
+them up front and a frame above kMaxRecordBytes is rejected unread.
+*/
+bool ReadRecordBatch(net::Connection& connection, vector<JournalRecord>& records) {
+    string header;
+    if (!connection.ReadExact(4, header)) return false;
+    uint32_t count = journal::GetU32(header.data());
+
+    records.clear();
+    records.reserve(min<uint32_t>(count, 4096));
+    for (uint32_t i = 0; i < count; ++i) {
+        string frame;
+        if (!connection.ReadExact(8, frame)) return false;
+        uint32_t length = journal::GetU32(frame.data());
+        if (length > journal::kMaxRecordBytes) return false;
+        if (!connection.ReadExact(length, frame)) return false;
+        size_t offset = 0;
+        JournalRecord record;
+        if (!journal::DecodeRecord(frame, offset, record)) return false;
+        records.push_back(move(record));
+    }
+    return true;
+}
+#endif
+
+/*
+Write-ahead log for live catalog edits.
+Purpose:
+- Make each add, update or remove durable before it is applied, without
+  rewriting or reloading the source CSV
+- Rebuild the catalog at startup from the latest snapshot plus the log
+  records written after it
+
+Group commit: Append() only buffers a record. WaitDurable() makes one
+thread the leader, which writes every buffered record with a single
+fsync while other callers wait and are released by that same flush.
+After kCompactionThreshold logged records the catalog is written to a
+new snapshot and the log is truncated; a failed snapshot is retried
+only after another kCompactionThreshold records.
+*/
+class CatalogJournal {
+private:
+    string logPath;
+    string snapshotPath;
+    FILE* logFile;
+    bool opened;                    // Open succeeded; edits go through the journal
+    bool snapshotDamaged;           // the snapshot was only partly read; never compact over it
+
+    mutex lock;
+    condition_variable flushed;
+    string pending;                 // encoded records not yet written
+    uint64_t appendedSequence;
+    uint64_t durableSequence;
+    bool flushing;
+    bool failed;                    // a write or sync failed; nothing after durableSequence is durable
+    size_t recordsSinceSnapshot;
+    size_t nextCompaction;          // recordsSinceSnapshot that triggers the next snapshot
+
+    static const size_t kCompactionThreshold = 10000;
+    static const char kSnapshotMagic[8];
+
+    // Waits for another kCompactionThreshold records before the next snapshot attempt
+    void deferCompaction() {
+        lock_guard<mutex> guard(lock);
+        nextCompaction = recordsSinceSnapshot + kCompactionThreshold;
+    }
+
+    bool openLog(const char* mode) {
+        if (logFile != nullptr) fclose(logFile);
+        logFile = fopen(logPath.c_str(), mode);
+        if (logFile == nullptr) {
+            cout << "Error: Unable to open journal " << logPath << endl;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    CatalogJournal()
+        : logFile(nullptr), opened(false), snapshotDamaged(false), appendedSequence(0),
+        durableSequence(0), flushing(false), failed(false), recordsSinceSnapshot(0),
+        nextCompaction(kCompactionThreshold) {
+    }
+
+    ~CatalogJournal() {
+        if (logFile != nullptr) {
+            WaitDurable(appendedSequence);
+            fclose(logFile);
+        }
+    }
+
+    CatalogJournal(const CatalogJournal&) = delete;
+    CatalogJournal& operator=(const CatalogJournal&) = delete;
+
+    // True once Open succeeded, even if the journal has failed since
+    bool IsOpen() const { return opened; }
+
+    /*
+    Opens the journal stored at basePath (basePath.log and basePath.snap)
+    and rebuilds the catalog from it. A torn record at the end of the log
+    is cut off so new records start at a valid boundary. A snapshot that
+    cannot be read to its end is reported and kept: the courses before
+    the damage are recovered, but it is never compacted over.
+    Returns true when a snapshot or log records were found. When the log
+    cannot be opened the catalog is left empty and edits stay unjournaled.
+    */
+    bool Open(const string& basePath, CourseCatalog& catalog) {
+        logPath = basePath + ".log";
+        snapshotPath = basePath + ".snap";
+        opened = false;
+        snapshotDamaged = false;
+
+        size_t snapshotCourses = 0;
+        string snapshot = journal::ReadFile(snapshotPath);
+        if (snapshot.size() >= sizeof(kSnapshotMagic)
+            && memcmp(snapshot.data(), kSnapshotMagic, sizeof(kSnapshotMagic)) == 0) {
+            size_t offset = sizeof(kSnapshotMagic);
+            JournalRecord record;
+            while (journal::DecodeRecord(snapshot, offset, record)) {
+                catalog.courseMap[record.course.courseNumber] = move(record.course);
+                snapshotCourses++;
+            }
+            snapshotDamaged = offset < snapshot.size();
+        }
+        else {
+            snapshotDamaged = !snapshot.empty();
+        }
+        if (snapshotDamaged) {
+            cout << "Warning: Journal snapshot " << snapshotPath << " is damaged; recovered "
+                << snapshotCourses << " courses before the damage and will not compact over it"
+                << endl;
+        }
+
+        string log = journal::ReadFile(logPath);
+        size_t offset = 0;
+        size_t replayed = 0;
+        JournalRecord record;
+        while (journal::DecodeRecord(log, offset, record)) {
+            if (record.op == JournalOp::Upsert) {
+                catalog.courseMap[record.course.courseNumber] = move(record.course);
+            }
+            else {
+                catalog.courseMap.erase(record.course.courseNumber);
+            }
+            replayed++;
+        }
+
+        if (offset < log.size()) {
+            cout << "Journal: discarding " << log.size() - offset
+                << " bytes of incomplete log tail" << endl;
+            error_code ignored;
+            filesystem::resize_file(logPath, offset, ignored);
+        }
+
+        // Records refused or lost before a reopen must never reach the new log
+        pending.clear();
+        appendedSequence = 0;
+        durableSequence = 0;
+        recordsSinceSnapshot = replayed;
+        nextCompaction = kCompactionThreshold;
+        failed = false;
+        if (!openLog("ab")) {
+            // Half-recovered records must not be merged into a later CSV load
+            catalog.courseMap.clear();
+            RebuildIndexes(catalog);
+            return false;
+        }
+        opened = true;
+
+        RebuildIndexes(catalog);
+        if (snapshotCourses > 0 || replayed > 0) {
+            cout << "Journal: recovered " << snapshotCourses << " courses from snapshot and "
+                << replayed << " log records" << endl;
+        }
+        return snapshotCourses > 0 || replayed > 0;
+    }
+
+    /*
+    Buffers a record and sets its sequence number for WaitDurable.
+    Returns false without buffering anything once the journal has failed.
+    */
+    bool Append(const JournalRecord& record, uint64_t& sequence) {
+        lock_guard<mutex> guard(lock);
+        if (failed) return false;
+        journal::EncodeRecord(pending, record);
+        recordsSinceSnapshot++;
+        sequence = ++appendedSequence;
+        return true;
+    }
+
+    /*
+    Blocks until the record with the given sequence number is on disk.
+    Whoever finds no flush in progress becomes the leader and commits
+    the whole buffered group with one write and one fsync.
+    Returns false when the record could not be made durable. A failed
+    write or fsync cannot be retried safely, so every later edit is
+    refused too until the journal is reopened.
+    */
+    bool WaitDurable(uint64_t sequence) {
+        unique_lock<mutex> guard(lock);
+        while (durableSequence < sequence) {
+            if (failed) return false;
+            if (flushing) {
+                flushed.wait(guard);
+                continue;
+            }
+
+            flushing = true;
+            string batch;
+            batch.swap(pending);
+            uint64_t batchEnd = appendedSequence;
+            guard.unlock();
+
+            bool written = true;
+            if (logFile != nullptr && !batch.empty()) {
+                written = fwrite(batch.data(), 1, batch.size(), logFile) == batch.size()
+                    && fflush(logFile) == 0 && FSYNC_FILE(logFile) == 0;
+            }
+
+            guard.lock();
+            if (written) {
+                durableSequence = batchEnd;
+            }
+            else {
+                failed = true;
+                pending.clear();   // appended during the failed flush; their waiters are refused
+                cout << "Error: Writing journal " << logPath
+                    << " failed; edits are refused until it is reopened" << endl;
+            }
+            flushing = false;
+            flushed.notify_all();
+        }
+        return true;
+    }
+
+    bool NeedsCompaction() const {
+        return recordsSinceSnapshot >= nextCompaction;
+    }
+
+    /*
+    Writes the full catalog to a new snapshot and truncates the log.
+    The snapshot is written to a temporary file, synced, and renamed over
+    the old one, so a crash leaves either the old or the new snapshot.
+    */
+    bool Compact(const CourseCatalog& catalog) {
+        if (!WaitDurable(appendedSequence)) return false;
+        if (snapshotDamaged) {
+            deferCompaction();
+            cout << "Warning: Not compacting over damaged snapshot " << snapshotPath << endl;
+            return false;
+        }
+
+        string temporaryPath = snapshotPath + ".tmp";
+        FILE* file = fopen(temporaryPath.c_str(), "wb");
+        if (file == nullptr) {
+            deferCompaction();
+            cout << "Error: Unable to write snapshot " << temporaryPath << endl;
+            return false;
+        }
+
+        bool written = true;
+        string buffer(kSnapshotMagic, sizeof(kSnapshotMagic));
+        for (const auto& pair : catalog.courseMap) {
+            journal::EncodeRecord(buffer, JournalRecord{ JournalOp::Upsert, pair.second });
+            if (buffer.size() >= (1 << 20)) {
+                written = written && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+                buffer.clear();
+            }
+        }
+        written = written && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size()
+            && fflush(file) == 0 && FSYNC_FILE(file) == 0;
+        written = fclose(file) == 0 && written;
+        if (!written) {
+            deferCompaction();
+            cout << "Error: Unable to write snapshot " << temporaryPath << endl;
+            remove(temporaryPath.c_str());
+            return false;
+        }
+
+#ifdef _WIN32
+        remove(snapshotPath.c_str());   // rename does not replace on Windows
+#endif
+        if (rename(temporaryPath.c_str(), snapshotPath.c_str()) != 0
+            || !journal::SyncDirectory(snapshotPath)) {
+            deferCompaction();
+            cout << "Error: Unable to replace snapshot " << snapshotPath << endl;
+            return false;
+        }
+
+        lock_guard<mutex> guard(lock);
+        recordsSinceSnapshot = 0;
+        nextCompaction = kCompactionThreshold;
+        if (openLog("wb")) return true;
+        // Without a log no later edit can be made durable, so refuse them
+        failed = true;
+        cout << "Error: Edits are refused until the journal is reopened" << endl;
+        return false;
+    }
+};
+
+const char CatalogJournal::kSnapshotMagic[8] = { 'C', 'S', '3', 'S', 'N', 'A', 'P', '1' };
+
+/*
+Publishes catalog changes to read-only followers.
+Stream format: a sequence of record batches (see ReadRecordBatch). The
+first batch a follower receives is a snapshot of the whole catalog;
+every later batch holds the changes of one edit or one reload, encoded
+once and written to every follower.
+The primary holds LockCatalog() while it changes the catalog, and a new
+follower's snapshot is taken under the same lock, so no change is
+either missed or applied twice. Writes are synchronous and bounded by
+kSendTimeoutMs: a follower that stops reading stalls the primary for at
+most that long per write, and is then dropped like one whose connection
+fails.
+*/
+class ReplicationPublisher {
+private:
+    mutex catalogLock;
+    const CourseCatalog* catalog;
+    atomic<bool> running;
+    thread acceptor;
+#ifndef _WIN32
+    int listener;
+    mutex followersLock;
+    vector<unique_ptr<net::Connection>> followers;
+
+    static const int kSendTimeoutMs = 2000;
+
+    // Bootstraps each new follower from a snapshot, then adds it to the stream
+    void acceptLoop() {
+        while (running) {
+            bool closed;
+            int fd = net::Accept(listener, closed);
+            if (closed) return;
+            if (fd < 0) continue;
+            auto follower = make_unique<net::Connection>(fd);
+            if (!net::SetTimeouts(fd, 0, kSendTimeoutMs)) continue;
+
+            lock_guard<mutex> guard(catalogLock);
+            string snapshot;
+            journal::PutU32(snapshot, static_cast<uint32_t>(catalog->courseMap.size()));
+            for (const auto& pair : catalog->courseMap) {
+                journal::EncodeRecord(snapshot, JournalRecord{ JournalOp::Upsert, pair.second });
+            }
+            if (!follower->WriteAll(snapshot)) continue;
+
+            lock_guard<mutex> followersGuard(followersLock);
+            followers.push_back(move(follower));
+        }
+    }
+#endif
+
+public:
+#ifndef _WIN32
+    ReplicationPublisher() : catalog(nullptr), running(false), listener(-1) {}
+#else
+    ReplicationPublisher() : catalog(nullptr), running(false) {}
+#endif
+
+    ~ReplicationPublisher() {
+        if (!running) return;
+        running = false;
+#ifndef _WIN32
+        shutdown(listener, SHUT_RDWR);   // wakes the blocked accept
+        acceptor.join();
+        close(listener);
+#endif
+    }
+
+    ReplicationPublisher(const ReplicationPublisher&) = delete;
+    ReplicationPublisher& operator=(const ReplicationPublisher&) = delete;
+
+    // Starts accepting followers on address (unix:/path or host:port)
+    bool Start(const string& address, const CourseCatalog& source) {
+#ifndef _WIN32
+        signal(SIGPIPE, SIG_IGN);   // a vanished follower must not end the primary
+        listener = net::OpenSocket(address, true);
+        if (listener < 0) {
+            cout << "Error: Unable to listen on " << address << endl;
+            return false;
+        }
+        catalog = &source;
+        running = true;
+        acceptor = thread(&ReplicationPublisher::acceptLoop, this);
+        cout << "Publishing catalog changes on " << address << endl;
+        return true;
+#else
+        (void)address;
+        (void)source;
+        cout << "Error: Replication requires POSIX sockets." << endl;
+        return false;
+#endif
+    }
+
+    bool IsRunning() const { return running; }
+
+    // Held by the primary for the whole of every catalog change
+    unique_lock<mutex> LockCatalog() { return unique_lock<mutex>(catalogLock); }
+
+    // Sends one batch of changes to every follower; call under LockCatalog
+    void Publish(const vector<JournalRecord>& records) {
+#ifndef _WIN32
+        if (!running || records.empty()) return;
+        string batch;
+        journal::PutU32(batch, static_cast<uint32_t>(records.size()));
+        for (const auto& record : records) journal::EncodeRecord(batch, record);
+
+        lock_guard<mutex> guard(followersLock);
+        auto failed = remove_if(followers.begin(), followers.end(),
+            [&](const unique_ptr<net::Connection>& follower) { return !follower->WriteAll(batch); });
+        followers.erase(failed, followers.end());
+#else
+        (void)records;
+#endif
+    }
+
+    // Publishes the current records of courses changed by a reload
+    void PublishCourses(const CourseCatalog& source, vector<string> courseNumbers) {
+        if (!running) return;
+        sort(courseNumbers.begin(), courseNumbers.end());
+        courseNumbers.erase(unique(courseNumbers.begin(), courseNumbers.end()), courseNumbers.end());
+        vector<JournalRecord> records;
+        records.reserve(courseNumbers.size());
+        for (const string& courseNumber : courseNumbers) {
+            records.push_back(JournalRecord{ JournalOp::Upsert, source.courseMap.at(courseNumber) });
+        }
+        Publish(records);
+    }
+};
+
+// Outcome of ApplyCatalogEdit
+enum class EditResult { Applied, NotFound, NotDurable };
+
+/*
+Applies one edit durably: the record is logged and synced first, then
+applied to the in-memory catalog and published to followers. Without a
+journal the edit is applied in memory only. An edit the journal could
+not make durable is not applied.
+*/
+EditResult ApplyCatalogEdit(CourseCatalog& catalog, CatalogJournal& catalogJournal,
+    ReplicationPublisher& publisher, const JournalRecord& record) {
+    if (record.op == JournalOp::Remove
+        && catalog.courseMap.find(record.course.courseNumber) == catalog.courseMap.end()) {
+        return EditResult::NotFound;
+    }
+
+    uint64_t sequence = 0;
+    if (catalogJournal.IsOpen() && !(catalogJournal.Append(record, sequence)
+        && catalogJournal.WaitDurable(sequence))) {
+        return EditResult::NotDurable;
+    }
+
+    {
+        auto guard = publisher.LockCatalog();
+        if (record.op == JournalOp::Upsert) {
+            UpsertCourse(catalog, record.course);
+        }
+        else {
+            RemoveCourse(catalog, record.course.courseNumber);
+        }
+        publisher.Publish({ record });
+    }
+
+    if (catalogJournal.IsOpen() && catalogJournal.NeedsCompaction()) {
+        catalogJournal.Compact(catalog);
+    }
+    return EditResult::Applied;
+}
+
+/*
+Lookup counts per course number, used to reorganize the read-only index.
+Counts are halved after every reorganization so the layout follows the
+current workload instead of all-time totals.
+*/
+class CourseAccessProfile {
+private:
+    unordered_map<string, uint64_t> counts;
+    size_t pendingAccesses;   // lookups recorded since the last reorganization
+
+public:
+    CourseAccessProfile() : pendingAccesses(0) {}
+
+    void Record(const Course& course) {
+        counts[course.courseNumber]++;
+        pendingAccesses++;
+    }
+
+    uint64_t Count(const string& courseNumber) const {
+        auto found = counts.find(courseNumber);
+        return found == counts.end() ? 0 : found->second;
+    }
+
+    size_t PendingAccesses() const { return pendingAccesses; }
+
+    void Decay() {
+        for (auto entry = counts.begin(); entry != counts.end();) {
+            entry->second /= 2;
+            if (entry->second == 0) entry = counts.erase(entry);
+            else ++entry;
+        }
+        pendingAccesses = 0;
+    }
+};
+
+/*
+Read-only copy of the catalog laid out by access frequency.
+Purpose:
+- Pack the most frequently looked-up courses together at the front of
+  one array instead of wherever insertion order left them on the heap
+- Keep hot course numbers near the root of the ordered structure
+
+The ordered structure is a treap keyed by course number whose priority
+is the access count, with ties broken by a hash of the course number so
+rarely used courses still form a balanced tree below the hot ones.
+Nodes are stored in descending priority order: a parent always comes
+before its children, the root is nodes[0], and the hottest records share
+the first few cache lines. The flat lookup table is rebuilt over the
+same array, so hashed lookups land on the packed records too.
+Like CourseIdIndex it records the catalog revision it was built from.
+*/
+class HotCourseIndex {
+private:
+    static constexpr uint32_t kNoNode = numeric_limits<uint32_t>::max();
+
+    struct HotNode {
+        Course course;
+        uint32_t left;
+        uint32_t right;
+    };
+
+    vector<HotNode, CatalogAllocator<HotNode>> nodes;
+    CourseLookupTable lookupTable;
+    uint64_t revision;
+    bool built;
+
+public:
+    HotCourseIndex() : revision(0), built(false) {}
+
+    /*
+    Rebuilds the index from the catalog and the recorded access counts.
+    The treap is built over the sorted course list in O(n) with a stack
+    holding its right spine, then nodes are sorted into priority order.
+    */
+    void Build(const CourseCatalog& catalog, const CourseAccessProfile& profile) {
+        vector<const Course*> sorted;
+        catalog.Ordered().CollectInOrder(sorted);
+        uint32_t count = static_cast<uint32_t>(sorted.size());
+
+        hash<string_view> hashKey;
+        vector<pair<uint64_t, size_t>> priority(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            priority[i] = { profile.Count(sorted[i]->courseNumber), hashKey(sorted[i]->courseNumber) };
+        }
+        // Index as the final tie-break makes the order strict
+        auto higher = [&](uint32_t a, uint32_t b) {
+            return priority[a] != priority[b] ? priority[a] > priority[b] : a < b;
+        };
+
+        vector<uint32_t> left(count, kNoNode);
+        vector<uint32_t> right(count, kNoNode);
+        vector<uint32_t> spine;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t last = kNoNode;
+            while (!spine.empty() && higher(i, spine.back())) {
+                last = spine.back();
+                spine.pop_back();
+            }
+            left[i] = last;
+            if (!spine.empty()) right[spine.back()] = i;
+            spine.push_back(i);
+        }
+
+        vector<uint32_t> order(count);
+        for (uint32_t i = 0; i < count; ++i) order[i] = i;
+        sort(order.begin(), order.end(), higher);
+        vector<uint32_t> position(count);
+        for (uint32_t p = 0; p < count; ++p) position[order[p]] = p;
+
+        nodes.clear();
+        nodes.reserve(count);
+        for (uint32_t i : order) {
+            nodes.push_back(HotNode{ *sorted[i],
+                left[i] == kNoNode ? kNoNode : position[left[i]],
+                right[i] == kNoNode ? kNoNode : position[right[i]] });
+        }
+
+        vector<const Course*> packed;
+        packed.reserve(count);
+        for (const HotNode& node : nodes) packed.push_back(&node.course);
+        lookupTable.Build(packed);
+
+        revision = catalog.revision;
+        built = true;
+    }
+
+    // True when the index reflects the catalog's current contents
+    bool IsCurrent(const CourseCatalog& catalog) const {
+        return built && revision == catalog.revision;
+    }
+
+    size_t Size() const { return nodes.size(); }
+
+    // Hashed lookups over the packed records
+    const CourseLookupTable& LookupTable() const { return lookupTable; }
+
+    /*
+    Ordered search from the root; hot courses are found within a few
+    levels, cold ones in O(log n) expected comparisons. The filter of the
+    packed lookup table turns away most absent keys before the descent.
+    */
+    const Course* FindOrdered(string_view courseNumber) const {
+        if (!lookupTable.MayContain(courseNumber)) return nullptr;
+
+        uint32_t node = nodes.empty() ? kNoNode : 0;
+        while (node != kNoNode) {
+            const HotNode& current = nodes[node];
+            int order = CompareCourseNumbers(courseNumber, current.course.courseNumber);
+            if (order == 0) return &current.course;
+            node = order < 0 ? current.left : current.right;
+        }
+        return nullptr;
+    }
+};
+
+// Lookups recorded between reorganizations of the hot index
+const size_t kReorganizeInterval = 1024;
+
+/*
+Rebuilds the hot index once enough lookups were recorded since the last
+rebuild, then halves the counts so older traffic gradually fades.
+*/
+void MaybeReorganize(const CourseCatalog& catalog, CourseAccessProfile& profile,
+    HotCourseIndex& hotIndex) {
+    if (profile.PendingAccesses() < kReorganizeInterval) return;
+    hotIndex.Build(catalog, profile);
+    profile.Decay();
+}
+
+namespace numa {
+
+/*
+NUMA layout read from sysfs: the CPUs of every online memory node.
+Machines without /sys/devices/system/node, and non-Linux builds, are
+treated as a single node holding every CPU.
+*/
+struct Topology {
+    vector<int> nodeIds;            // kernel node numbers, ascending
+    vector<vector<int>> nodeCpus;   // CPUs of each node, same order as nodeIds
+    vector<int> cpuNode;            // index into nodeIds for each CPU id, -1 if unknown
+
+    size_t NodeCount() const { return nodeIds.size(); }
+
+    size_t NodeOfCpu(int cpu) const {
+        if (cpu < 0 || static_cast<size_t>(cpu) >= cpuNode.size() || cpuNode[cpu] < 0) return 0;
+        return static_cast<size_t>(cpuNode[cpu]);
+    }
+};
+
+// Parses a sysfs CPU list such as "0-3,8-11"
+vector<int> ParseCpuList(const string& text) {
+    vector<int> cpus;
+    stringstream ss(text);
+    string range;
+    while (getline(ss, range, ',')) {
+        if (range.empty() || !isdigit(static_cast<unsigned char>(range[0]))) continue;
+        size_t dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = (dash == string::npos) ? first : atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+Topology Detect() {
+    Topology topology;
+    error_code error;
+    vector<int> ids;
+    for (const auto& entry : filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        string name = entry.path().filename().string();
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0
+            && all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            ids.push_back(atoi(name.c_str() + 4));
+        }
+    }
+    sort(ids.begin(), ids.end());
+
+    for (int id : ids) {
+        ifstream file("/sys/devices/system/node/node" + to_string(id) + "/cpulist");
+        string text;
+        getline(file, text);
+        vector<int> cpus = ParseCpuList(text);
+        if (cpus.empty()) continue;   // memory-only nodes run no threads
+        topology.nodeIds.push_back(id);
+        topology.nodeCpus.push_back(move(cpus));
+    }
+
+    if (topology.nodeIds.empty()) {
+        unsigned cores = max(1u, thread::hardware_concurrency());
+        topology.nodeIds.push_back(0);
+        topology.nodeCpus.emplace_back();
+        for (unsigned cpu = 0; cpu < cores; ++cpu) topology.nodeCpus[0].push_back(static_cast<int>(cpu));
+    }
+
+    for (size_t node = 0; node < topology.nodeCpus.size(); ++node) {
+        for (int cpu : topology.nodeCpus[node]) {
+            if (static_cast<size_t>(cpu) >= topology.cpuNode.size()) topology.cpuNode.resize(cpu + 1, -1);
+            topology.cpuNode[cpu] = static_cast<int>(node);
+        }
+    }
+    return topology;
+}
+
+// Node (index into nodeIds) of the CPU the calling thread is running on
+size_t CurrentNode(const Topology& topology) {
+#ifdef __linux__
+    if (topology.NodeCount() > 1) return topology.NodeOfCpu(sched_getcpu());
+#endif
+    return 0;
+}
+
+/*
+Runs task on a thread restricted to the CPUs of one node and waits for
+it. Memory the task touches first is placed on that node by the
+kernel's default first-touch policy.
+*/
+void RunOnNode(const Topology& topology, size_t node, const function<void()>& task) {
+    thread worker([&]() {
+#ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu : topology.nodeCpus[node]) CPU_SET(cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+        (void)topology;
+        (void)node;
+#endif
+        task();
+    });
+    worker.join();
+}
+
+/*
+Runs task on a thread whose new pages are interleaved round robin over
+every node, and waits for it. Falls back to the default policy where
+set_mempolicy is unavailable.
+*/
+void RunInterleaved(const Topology& topology, const function<void()>& task) {
+    thread worker([&]() {
+#ifdef __linux__
+        unsigned long mask = 0;
+        for (int id : topology.nodeIds) {
+            if (id < static_cast<int>(sizeof(mask) * 8)) mask |= 1UL << id;
+        }
+        syscall(SYS_set_mempolicy, MPOL_INTERLEAVE, &mask, sizeof(mask) * 8);
+#else
+        (void)topology;
+#endif
+        task();
+    });
+    worker.join();
+}
+
+} // namespace numa
+
+// How NumaCatalogReplicas places the catalog copies in memory
+enum class NumaPlacement { Off, FirstTouch, Interleave };
+
+/*
+Read-only copy of the course records with its own lookup table.
+Built entirely by one thread, so under first touch every page of the
+copy lands on that thread's node.
+*/
+class CatalogReplica {
+private:
+    vector<Course> courses;
+    CourseLookupTable lookupTable;
+
+public:
+    void Build(const CourseCatalog& catalog) {
+        courses.clear();
+        courses.reserve(catalog.courseMap.size());
+        for (const auto& pair : catalog.courseMap) courses.push_back(pair.second);
+
+        // Pointers are taken after every push so reallocation cannot move them
+        vector<const Course*> pointers;
+        pointers.reserve(courses.size());
+        for (const Course& course : courses) pointers.push_back(&course);
+        lookupTable.Build(pointers);
+    }
+
+    const CourseLookupTable& LookupTable() const { return lookupTable; }
+};
+
+/*
+Per-NUMA-node replicas of the catalog's lookup data.
+With first touch, one replica per node is built on a thread restricted
+to that node's CPUs, so its pages sit in local memory; each lookup then
+uses the replica of the node the calling thread runs on, and pinned
+scheduler workers always read local memory.
+With interleave, one copy is built with its pages spread over all
+nodes, which evens out remote traffic without extra memory.
+Single-node machines gain nothing, so Enabled() is false there and the
+catalog's own table is used. Replicas are rebuilt lazily when the
+catalog revision changes.
+*/
+class NumaCatalogReplicas {
+private:
+    numa::Topology topology;
+    NumaPlacement placement;
+    vector<unique_ptr<CatalogReplica>> replicas;
+    uint64_t revision;
+    bool built;
+
+public:
+    NumaCatalogReplicas() : placement(NumaPlacement::Off), revision(0), built(false) {}
+
+    void Configure(NumaPlacement mode) {
+        placement = mode;
+        topology = numa::Detect();
+        replicas.clear();
+        built = false;
+    }
+
+    bool Enabled() const { return placement != NumaPlacement::Off && topology.NodeCount() > 1; }
+
+    NumaPlacement Placement() const { return placement; }
+
+    const numa::Topology& GetTopology() const { return topology; }
+
+    // Builds every replica now, even on one node (the benchmark relies on this)
+    void Build(const CourseCatalog& catalog) {
+        size_t copies = (placement == NumaPlacement::Interleave) ? 1 : topology.NodeCount();
+        replicas.resize(copies);
+        for (size_t node = 0; node < copies; ++node) {
+            replicas[node].reset();   // free the old copy before building its successor
+            auto build = [&]() {
+                replicas[node] = make_unique<CatalogReplica>();
+                replicas[node]->Build(catalog);
+            };
+            if (placement == NumaPlacement::Interleave) numa::RunInterleaved(topology, build);
+            else numa::RunOnNode(topology, node, build);
+        }
+        revision = catalog.revision;
+        built = true;
+    }
+
+    bool IsCurrent(const CourseCatalog& catalog) const {
+        return built && revision == catalog.revision;
+    }
+
+    // Replica table for the calling thread's node
+    const CourseLookupTable& LocalLookupTable() const {
+        if (replicas.size() == 1) return replicas[0]->LookupTable();
+        return replicas[numa::CurrentNode(topology)]->LookupTable();
+    }
+};
+
+/*
+Lookup table to query: the calling thread's NUMA replica when
+replication is enabled, else the reorganized copy while it is current,
+otherwise the catalog's own table with its filter brought up to date.
+*/
+const CourseLookupTable& ActiveLookupTable(CourseCatalog& catalog,
+    const HotCourseIndex& hotIndex, NumaCatalogReplicas& replicas) {
+    if (replicas.Enabled()) {
+        if (!replicas.IsCurrent(catalog)) replicas.Build(catalog);
+        return replicas.LocalLookupTable();
+    }
+    if (hotIndex.IsCurrent(catalog)) return hotIndex.LookupTable();
+    catalog.lookupTable.RefreshFilter();
+    return catalog.lookupTable;
+}
+
+/*
+Prints the title and prerequisite list of one course record.
+*/
+void PrintCourseDetails(const Course& course) {
+    cout << course.courseNumber << ", " << course.courseTitle << endl;
+
+    if (course.prerequisites.empty()) {
+        cout << "Prerequisites: None" << endl;
+    }
+    else {
+        cout << "Prerequisites: ";
+        for (size_t i = 0; i < course.prerequisites.size(); ++i) {
+            cout << course.prerequisites[i];
+            if (i < course.prerequisites.size() - 1) cout << ", ";
+        }
+        cout << endl;
+    }
+}
+
+/*
+Looks up a course from raw user input.
+The query is trimmed and uppercased into a stack buffer, so lookups are
+case-insensitive, ignore surrounding whitespace and never allocate.
+*/
+const Course* FindCourse(string_view input, const CourseLookupTable& lookupTable) {
+    char buffer[kMaxCourseKeyLength];
+    size_t length = NormalizeCourseKey(input, buffer, sizeof(buffer));
+    if (length == 0) return nullptr;
+    return lookupTable.Find(string_view(buffer, length));
+}
+
+/*
+Prints detailed information for a single course.
+Uses hash table lookup for O(1) average-time access.
+*/
+void PrintCourseDetails(string_view courseInput, const CourseLookupTable& lookupTable,
+    CourseAccessProfile& profile) {
+    const Course* course = FindCourse(courseInput, lookupTable);
+    if (course == nullptr) {
+        cout << "Course not found." << endl;
+        return;
+    }
+
+    profile.Record(*course);
+    PrintCourseDetails(*course);
+}
+
+/*
+Prints several courses with one batched lookup.
+Input is a list of course numbers separated by spaces or commas;
+results are printed in the order the course numbers were entered.
+*/
+void PrintCourseBatch(const string& input, const CourseLookupTable& lookupTable,
+    CourseAccessProfile& profile) {
+    vector<string> courseNumbers;
+    string token;
+    for (char c : input) {
+        if (c == ',' || c == ' ' || c == '\t') {
+            if (!token.empty()) courseNumbers.push_back(token);
+            token.clear();
+        }
+        else {
+            token += c;
+        }
+    }
+    if (!token.empty()) courseNumbers.push_back(token);
+
+    for (string& courseNumber : courseNumbers) {
+        CanonicalizeCourseKey(courseNumber);
+    }
+
+    vector<const Course*> results = lookupTable.FindBatch(courseNumbers);
+    for (size_t i = 0; i < results.size(); ++i) {
+        cout << endl;
+        if (results[i] == nullptr) {
+            cout << courseNumbers[i] << ": Course not found." << endl;
+        }
+        else {
+            profile.Record(*results[i]);
+            PrintCourseDetails(*results[i]);
+        }
+    }
+}
+
+/*
+Node of the persistent ordered index.
+Nodes are immutable once built; a new version copies only the nodes on
+the path to a change and points at every other node of the old version.
+The tree is a treap whose priorities come from a hash of the course
+number, so the same set of courses always has the same balanced shape
+no matter which order terms add them in.
+*/
+struct PersistentTreeNode {
+    shared_ptr<const Course> course;
+    shared_ptr<const PersistentTreeNode> left;
+    shared_ptr<const PersistentTreeNode> right;
+    uint64_t priority;
+    size_t subtreeSize;
+};
+
+using PersistentTree = shared_ptr<const PersistentTreeNode>;
+
+/*
+Node of the persistent hash trie (hash array mapped trie).
+Each level consumes 5 bits of the key hash; the bitmap records which of
+the 32 possible children exist and children are stored densely in
+bitmap order. Past the last full level, keys whose hashes are equal are
+kept in a plain collision list.
+*/
+struct PersistentTrieNode;
+using PersistentTrie = shared_ptr<const PersistentTrieNode>;
+
+struct PersistentTrieEntry {
+    uint64_t hash;
+    shared_ptr<const Course> course;   // set for leaves
+    PersistentTrie child;              // set for sub-tries
+};
+
+struct PersistentTrieNode {
+    uint32_t bitmap;
+    vector<PersistentTrieEntry> entries;
+};
+
+/*
+Path-copying operations on the persistent structures.
+Every function returns a new root and leaves its input untouched.
+*/
+namespace persistent {
+
+    const unsigned kTrieBits = 5;
+    const unsigned kTrieMaxShift = 60;   // deeper levels become collision lists
+
+    size_t SizeOf(const PersistentTree& node) {
+        return node ? node->subtreeSize : 0;
+    }
+
+    PersistentTree MakeNode(shared_ptr<const Course> course, uint64_t priority,
+        PersistentTree left, PersistentTree right) {
+        auto node = make_shared<PersistentTreeNode>();
+        node->subtreeSize = SizeOf(left) + SizeOf(right) + 1;
+        node->course = move(course);
+        node->priority = priority;
+        node->left = move(left);
+        node->right = move(right);
+        return node;
+    }
+
+    // Splits into courses ordered before key and courses at or after key
+    void Split(const PersistentTree& node, const string& key,
+        PersistentTree& less, PersistentTree& greaterOrEqual) {
+        if (!node) {
+            less = nullptr;
+            greaterOrEqual = nullptr;
+        }
+        else if (CompareCourseNumbers(node->course->courseNumber, key) < 0) {
+            PersistentTree rightLess;
+            Split(node->right, key, rightLess, greaterOrEqual);
+            less = MakeNode(node->course, node->priority, node->left, rightLess);
+        }
+        else {
+            PersistentTree leftGreater;
+            Split(node->left, key, less, leftGreater);
+            greaterOrEqual = MakeNode(node->course, node->priority, leftGreater, node->right);
+        }
+    }
+
+    // Joins two trees where every key in left sorts before every key in right
+    PersistentTree Merge(const PersistentTree& left, const PersistentTree& right) {
+        if (!left) return right;
+        if (!right) return left;
+        if (left->priority > right->priority) {
+            return MakeNode(left->course, left->priority, left->left, Merge(left->right, right));
+        }
+        return MakeNode(right->course, right->priority, Merge(left, right->left), right->right);
+    }
+
+    /*
+    Inserts a course or replaces the course with the same number.
+    A stored course with the same number has the same priority, so it is
+    always reached by the equality test before a split could be needed.
+    Expected complexity: O(log n) time and O(log n) new nodes.
+    */
+    PersistentTree Assign(const PersistentTree& node, shared_ptr<const Course> course,
+        uint64_t priority) {
+        if (!node || priority > node->priority) {
+            PersistentTree less;
+            PersistentTree greaterOrEqual;
+            Split(node, course->courseNumber, less, greaterOrEqual);
+            return MakeNode(move(course), priority, less, greaterOrEqual);
+        }
+        if (course->courseNumber == node->course->courseNumber) {
+            return MakeNode(move(course), node->priority, node->left, node->right);
+        }
+        if (CompareCourseNumbers(course->courseNumber, node->course->courseNumber) < 0) {
+            return MakeNode(node->course, node->priority,
+                Assign(node->left, move(course), priority), node->right);
+        }
+        return MakeNode(node->course, node->priority,
+            node->left, Assign(node->right, move(course), priority));
+    }
+
+    // Removes the course with the given number if present
+    PersistentTree Erase(const PersistentTree& node, const string& key) {
+        if (!node) return node;
+        if (key == node->course->courseNumber) return Merge(node->left, node->right);
+        if (CompareCourseNumbers(key, node->course->courseNumber) < 0) {
+            PersistentTree left = Erase(node->left, key);
+            if (left == node->left) return node;
+            return MakeNode(node->course, node->priority, left, node->right);
+        }
+        PersistentTree right = Erase(node->right, key);
+        if (right == node->right) return node;
+        return MakeNode(node->course, node->priority, node->left, right);
+    }
+
+    // Index of a child slot within a bitmap node
+    size_t DenseIndex(uint32_t bitmap, uint32_t bit) {
+        return bitset<32>(bitmap & (bit - 1)).count();
+    }
+
+    PersistentTrie TrieAssign(const PersistentTrie& node, uint64_t hash,
+        shared_ptr<const Course> course, unsigned shift);
+
+    // Builds the smallest sub-trie holding two leaves
+    PersistentTrie TrieFromPair(const PersistentTrieEntry& existing, uint64_t hash,
+        shared_ptr<const Course> course, unsigned shift) {
+        auto node = make_shared<PersistentTrieNode>();
+        node->bitmap = 0;
+        if (shift >= kTrieMaxShift) {
+            node->entries.push_back(existing);
+            node->entries.push_back(PersistentTrieEntry{ hash, move(course), nullptr });
+            return node;
+        }
+        uint32_t bit = 1u << ((existing.hash >> shift) & 31);
+        node->bitmap = bit;
+        node->entries.push_back(existing);
+        return TrieAssign(node, hash, move(course), shift);
+    }
+
+    /*
+    Inserts or replaces a course in the hash trie.
+    Copies at most one node per level (about 13 levels for 64-bit hashes).
+    */
+    PersistentTrie TrieAssign(const PersistentTrie& node, uint64_t hash,
+        shared_ptr<const Course> course, unsigned shift) {
+        auto copy = node ? make_shared<PersistentTrieNode>(*node)
+            : make_shared<PersistentTrieNode>(PersistentTrieNode{ 0, {} });
+
+        if (shift >= kTrieMaxShift) {
+            for (auto& entry : copy->entries) {
+                if (entry.course->courseNumber == course->courseNumber) {
+                    entry.course = move(course);
+                    return copy;
+                }
+            }
+            copy->entries.push_back(PersistentTrieEntry{ hash, move(course), nullptr });
+            return copy;
+        }
+
+        uint32_t bit = 1u << ((hash >> shift) & 31);
+        size_t index = DenseIndex(copy->bitmap, bit);
+        if ((copy->bitmap & bit) == 0) {
+            copy->bitmap |= bit;
+            copy->entries.insert(copy->entries.begin() + index,
+                PersistentTrieEntry{ hash, move(course), nullptr });
+            return copy;
+        }
+
+        PersistentTrieEntry& entry = copy->entries[index];
+        if (entry.child) {
+            entry.child = TrieAssign(entry.child, hash, move(course), shift + kTrieBits);
+        }
+        else if (entry.course->courseNumber == course->courseNumber) {
+            entry.course = move(course);
+        }
+        else {
+            PersistentTrieEntry existing = entry;
+            entry.course = nullptr;
+            entry.child = TrieFromPair(existing, hash, move(course), shift + kTrieBits);
+        }
+        return copy;
+    }
+
+    // Removes a course from the hash trie; empty nodes are dropped
+    PersistentTrie TrieErase(const PersistentTrie& node, uint64_t hash,
+        const string& key, unsigned shift) {
+        if (!node) return node;
+
+        if (shift >= kTrieMaxShift) {
+            for (size_t i = 0; i < node->entries.size(); ++i) {
+                if (node->entries[i].course->courseNumber == key) {
+                    auto copy = make_shared<PersistentTrieNode>(*node);
+                    copy->entries.erase(copy->entries.begin() + i);
+                    return copy->entries.empty() ? nullptr : PersistentTrie(copy);
+                }
+            }
+            return node;
+        }
+
+        uint32_t bit = 1u << ((hash >> shift) & 31);
+        if ((node->bitmap & bit) == 0) return node;
+        size_t index = DenseIndex(node->bitmap, bit);
+        const PersistentTrieEntry& entry = node->entries[index];
+
+        PersistentTrie child;
+        if (entry.child) {
+            child = TrieErase(entry.child, hash, key, shift + kTrieBits);
+            if (child == entry.child) return node;
+        }
+        else if (entry.course->courseNumber != key) {
+            return node;
+        }
+
+        auto copy = make_shared<PersistentTrieNode>(*node);
+        if (child) {
+            copy->entries[index].child = child;
+        }
+        else {
+            copy->bitmap &= ~bit;
+            copy->entries.erase(copy->entries.begin() + index);
+            if (copy->entries.empty()) return nullptr;
+        }
+        return copy;
+    }
+
+    // Looks up a course by number; O(1) levels for practical catalog sizes
+    const Course* TrieFind(const PersistentTrie& root, uint64_t hash, string_view key) {
+        const PersistentTrieNode* node = root.get();
+        unsigned shift = 0;
+        while (node != nullptr) {
+            if (shift >= kTrieMaxShift) {
+                for (const auto& entry : node->entries) {
+                    if (entry.course->courseNumber == key) return entry.course.get();
+                }
+                return nullptr;
+            }
+            uint32_t bit = 1u << ((hash >> shift) & 31);
+            if ((node->bitmap & bit) == 0) return nullptr;
+            const PersistentTrieEntry& entry = node->entries[DenseIndex(node->bitmap, bit)];
+            if (!entry.child) {
+                return entry.course->courseNumber == key ? entry.course.get() : nullptr;
+            }
+            node = entry.child.get();
+            shift += kTrieBits;
+        }
+        return nullptr;
+    }
+
+    // Records every tree and trie node reachable from a version
+    void CollectNodes(const PersistentTree& node, unordered_set<const void*>& seen) {
+        if (!node || !seen.insert(node.get()).second) return;
+        CollectNodes(node->left, seen);
+        CollectNodes(node->right, seen);
+    }
+
+    void CollectNodes(const PersistentTrie& node, unordered_set<const void*>& seen) {
+        if (!node || !seen.insert(node.get()).second) return;
+        for (const auto& entry : node->entries) {
+            if (entry.child) CollectNodes(entry.child, seen);
+        }
+    }
+
+}  // namespace persistent
+
+/*
+Catalog as of one academic term.
+Both roots belong to one immutable snapshot: the treap for sorted output
+and the hash trie for lookups.
+*/
+struct CatalogVersion {
+    string term;
+    PersistentTree orderedRoot;
+    PersistentTrie lookupRoot;
+};
+
+/*
+Keeps every loaded term as a persistent catalog version.
+Each new term starts from the latest version and applies only the
+differences, so unchanged courses and untouched subtrees are shared
+between terms instead of being copied.
+*/
+class TermCatalog {
+private:
+    vector<CatalogVersion> versions;
+
+    const CatalogVersion* findVersion(const string& term) const {
+        for (const auto& version : versions) {
+            if (version.term == term) return &version;
+        }
+        return nullptr;
+    }
+
+    static void collectCourses(const PersistentTree& node, vector<const Course*>& courses) {
+        if (!node) return;
+        collectCourses(node->left, courses);
+        courses.push_back(node->course.get());
+        collectCourses(node->right, courses);
+    }
+
+public:
+    /*
+    Loads a term's CSV file as a new version.
+    A term that is already loaded is replaced by the new file contents.
+    */
+    bool LoadTerm(const string& term, const string& filename, TaskScheduler& scheduler) {
+        vector<Course> parsed;
+        if (!ReadCourseFile(filename, parsed, scheduler)) return false;
+
+        CatalogVersion next;
+        next.term = term;
+        if (!versions.empty()) {
+            next.orderedRoot = versions.back().orderedRoot;
+            next.lookupRoot = versions.back().lookupRoot;
+        }
+
+        size_t added = 0;
+        size_t changed = 0;
+        size_t removed = 0;
+        unordered_set<string> present;
+
+        for (Course& course : parsed) {
+            present.insert(course.courseNumber);
+            uint64_t hash = HashCourseNumber(course.courseNumber);
+            const Course* previous = persistent::TrieFind(next.lookupRoot, hash, course.courseNumber);
+            if (previous != nullptr && *previous == course) continue;
+
+            if (previous == nullptr) added++;
+            else changed++;
+
+            auto shared = make_shared<const Course>(move(course));
+            next.orderedRoot = persistent::Assign(next.orderedRoot, shared, hash);
+            next.lookupRoot = persistent::TrieAssign(next.lookupRoot, hash, shared, 0);
+        }
+
+        // Courses missing from this term's file are dropped from the new version
+        vector<const Course*> existing;
+        collectCourses(next.orderedRoot, existing);
+        vector<string> retired;
+        for (const Course* course : existing) {
+            if (present.count(course->courseNumber) == 0) retired.push_back(course->courseNumber);
+        }
+        for (const string& courseNumber : retired) {
+            uint64_t hash = HashCourseNumber(courseNumber);
+            next.orderedRoot = persistent::Erase(next.orderedRoot, courseNumber);
+            next.lookupRoot = persistent::TrieErase(next.lookupRoot, hash, courseNumber, 0);
+            removed++;
+        }
+
+        auto same = find_if(versions.begin(), versions.end(),
+            [&](const CatalogVersion& version) { return version.term == term; });
+        if (same != versions.end()) versions.erase(same);
+        versions.push_back(move(next));
+
+        cout << "Term " << term << ": " << persistent::SizeOf(versions.back().orderedRoot)
+            << " courses (" << added << " added, " << changed << " changed, "
+            << removed << " removed)" << endl;
+        return true;
+    }
+
+    // Course as of the given term, or nullptr when the term or course is unknown
+    const Course* FindCourse(const string& term, string_view courseNumber) const {
+        const CatalogVersion* version = findVersion(term);
+        if (version == nullptr) return nullptr;
+        uint64_t hash = HashCourseNumber(courseNumber);
+        return persistent::TrieFind(version->lookupRoot, hash, courseNumber);
+    }
+
+    bool HasTerm(const string& term) const {
+        return findVersion(term) != nullptr;
+    }
+
+    /*
+    Prints each term with its course count, followed by how many nodes
+    all versions hold together compared with fully independent copies.
+    */
+    void PrintSummary() const {
+        unordered_set<const void*> shared;
+        size_t independent = 0;
+        for (const auto& version : versions) {
+            unordered_set<const void*> own;
+            persistent::CollectNodes(version.orderedRoot, own);
+            persistent::CollectNodes(version.lookupRoot, own);
+            independent += own.size();
+            shared.insert(own.begin(), own.end());
+            cout << version.term << ": " << persistent::SizeOf(version.orderedRoot)
+                << " courses" << endl;
+        }
+        cout << "Index nodes held: " << shared.size() << " (independent copies would need "
+            << independent << ")" << endl;
+    }
+};
+
+/*
+Concurrent ordered index for course numbers (lazy skip list).
+Purpose:
+- Let edits and queries run at the same time on many threads, which
+  the pointer-based CourseBST cannot do without one global lock
+- Reads (Find, ForEach) take no locks and never wait
+- Insert and Remove lock only the few predecessor nodes they change,
+  validate that nothing moved, and retry otherwise
+
+A removed node is first marked (logical delete) and then unlinked.
+Readers may still be standing on an unlinked node, so it is retired and
+freed by epoch-based reclamation once every operation that could have
+seen it has finished.
+Course records in the index are immutable; an update is remove + insert.
+Only RunConcurrentIndexBenchmark uses this class; the menu's catalog is
+edited under the replication lock and does not need it.
+*/
+class ConcurrentCourseIndex {
+private:
+    static const int kMaxLevel = 24;
+
+    struct SkipNode {
+        Course course;
+        int topLevel;
+        int sentinel;                          // -1 head, +1 tail, 0 course
+        atomic<SkipNode*> next[kMaxLevel];
+        mutex lock;
+        atomic<bool> marked;
+        atomic<bool> fullyLinked;
+
+        SkipNode(const Course& value, int levels, int kind)
+            : course(value), topLevel(levels - 1), sentinel(kind),
+            marked(false), fullyLinked(false) {
+            for (auto& link : next) link.store(nullptr, memory_order_relaxed);
+        }
+    };
+
+    // Reader counts for the two live epochs, spread over cache lines
+    struct alignas(64) EpochStripe {
+        atomic<size_t> active[2];
+    };
+    static const size_t kStripes = 64;
+    static const size_t kReclaimBatch = 256;
+
+    SkipNode* head;
+    SkipNode* tail;
+    atomic<size_t> count;
+    atomic<uint64_t> epoch;
+    unique_ptr<EpochStripe[]> stripes;
+    mutex retiredLock;
+    vector<SkipNode*> retired;      // unlinked, possibly still seen by readers
+    mutex reclaimLock;
+
+    static size_t stripeForThread() {
+        static thread_local size_t stripe = hash<thread::id>()(this_thread::get_id()) % kStripes;
+        return stripe;
+    }
+
+    /*
+    Marks the calling thread as inside an operation of the current epoch.
+    Every operation runs inside one, and nothing it reads is freed until
+    it ends. The epoch is checked again after counting in so a reader
+    can never join an epoch whose readers were already drained.
+    */
+    class OperationScope {
+    private:
+        atomic<size_t>* counter;
+
+    public:
+        explicit OperationScope(const ConcurrentCourseIndex& index) {
+            EpochStripe& stripe = index.stripes[stripeForThread()];
+            while (true) {
+                uint64_t current = index.epoch.load();
+                counter = &stripe.active[current & 1];
+                counter->fetch_add(1);
+                if (index.epoch.load() == current) break;
+                counter->fetch_sub(1, memory_order_release);
+            }
+        }
+
+        ~OperationScope() { counter->fetch_sub(1, memory_order_release); }
+
+        OperationScope(const OperationScope&) = delete;
+        OperationScope& operator=(const OperationScope&) = delete;
+    };
+
+    /*
+    Frees retired nodes once a batch has built up. The batch was unlinked
+    before the epoch advanced, so only operations counted in the old epoch
+    can still reach it; waiting for that count to drain makes it safe.
+    Called outside any OperationScope, and by one thread at a time.
+    */
+    void reclaim() {
+        unique_lock<mutex> reclaiming(reclaimLock, try_to_lock);
+        if (!reclaiming.owns_lock()) return;
+        vector<SkipNode*> batch;
+        {
+            lock_guard<mutex> guard(retiredLock);
+            if (retired.size() < kReclaimBatch) return;
+            batch.swap(retired);
+        }
+        size_t previous = epoch.fetch_add(1) & 1;
+        for (size_t i = 0; i < kStripes; ++i) {
+            while (stripes[i].active[previous].load(memory_order_acquire) != 0) {
+                this_thread::yield();
+            }
+        }
+        for (SkipNode* node : batch) delete node;
+    }
+
+    // Orders sentinels around every real course number
+    static bool before(const SkipNode* node, const string& key) {
+        if (node->sentinel != 0) return node->sentinel < 0;
+        return CompareCourseNumbers(node->course.courseNumber, key) < 0;
+    }
+
+    static bool matches(const SkipNode* node, const string& key) {
+        return node->sentinel == 0 && node->course.courseNumber == key;
+    }
+
+    // Geometric level with p = 1/2 from a per-thread generator
+    static int randomLevels() {
+        static thread_local mt19937_64 generator(random_device{}());
+        uint64_t bits = generator();
+        int levels = 1;
+        while ((bits & 1) && levels < kMaxLevel) {
+            levels++;
+            bits >>= 1;
+        }
+        return levels;
+    }
+
+    /*
+    Fills the predecessor and successor at every level and returns the
+    highest level where the key was found, or -1. Takes no locks.
+    */
+    int findNode(const string& key, SkipNode** preds, SkipNode** succs) const {
+        int found = -1;
+        SkipNode* pred = head;
+        for (int level = kMaxLevel - 1; level >= 0; --level) {
+            SkipNode* current = pred->next[level].load(memory_order_acquire);
+            while (before(current, key)) {
+                pred = current;
+                current = pred->next[level].load(memory_order_acquire);
+            }
+            if (found == -1 && matches(current, key)) found = level;
+            preds[level] = pred;
+            succs[level] = current;
+        }
+        return found;
+    }
+
+    // Locks each distinct predecessor once, lowest level first
+    static void unlockAll(SkipNode** preds, int highest) {
+        SkipNode* previous = nullptr;
+        for (int level = 0; level <= highest; ++level) {
+            if (preds[level] != previous) {
+                preds[level]->lock.unlock();
+                previous = preds[level];
+            }
+        }
+    }
+
+public:
+    ConcurrentCourseIndex() : count(0), epoch(0), stripes(new EpochStripe[kStripes]) {
+        for (size_t i = 0; i < kStripes; ++i) {
+            stripes[i].active[0] = 0;
+            stripes[i].active[1] = 0;
+        }
+        head = new SkipNode(Course(), kMaxLevel, -1);
+        tail = new SkipNode(Course(), kMaxLevel, 1);
+        for (int level = 0; level < kMaxLevel; ++level) {
+            head->next[level].store(tail, memory_order_relaxed);
+        }
+        head->fullyLinked = true;
+        tail->fullyLinked = true;
+    }
+
+    // Must only run once no other thread is using the index
+    ~ConcurrentCourseIndex() {
+        SkipNode* node = head;
+        while (node != nullptr) {
+            SkipNode* next = node->next[0].load(memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+        for (SkipNode* node : retired) delete node;
+    }
+
+    ConcurrentCourseIndex(const ConcurrentCourseIndex&) = delete;
+    ConcurrentCourseIndex& operator=(const ConcurrentCourseIndex&) = delete;
+
+    size_t Size() const { return count.load(memory_order_relaxed); }
+
+    /*
+    Lock-free lookup: one descent, no retries.
+    A course is visible once it is fully linked and until it is marked.
+    The record is copied into copy, when given, because the node may be
+    freed as soon as the lookup returns.
+    */
+    bool Find(const string& courseNumber, Course* copy = nullptr) const {
+        OperationScope scope(*this);
+        SkipNode* preds[kMaxLevel];
+        SkipNode* succs[kMaxLevel];
+        int level = findNode(courseNumber, preds, succs);
+        if (level == -1) return false;
+        SkipNode* node = succs[level];
+        if (!node->fullyLinked.load(memory_order_acquire)
+            || node->marked.load(memory_order_acquire)) {
+            return false;
+        }
+        if (copy != nullptr) *copy = node->course;
+        return true;
+    }
+
+    /*
+    Adds a course; returns false if the course number is already present.
+    Locks the predecessors, checks they still point at the expected
+    successors and are not deleted, then links the new node bottom-up.
+    */
+    bool Insert(const Course& course) {
+        OperationScope scope(*this);
+        const string& key = course.courseNumber;
+        int levels = randomLevels();
+        SkipNode* preds[kMaxLevel];
+        SkipNode* succs[kMaxLevel];
+
+        while (true) {
+            int found = findNode(key, preds, succs);
+            if (found != -1) {
+                SkipNode* existing = succs[found];
+                if (!existing->marked.load(memory_order_acquire)) {
+                    // Wait until a concurrent insert of the same key finishes linking
+                    while (!existing->fullyLinked.load(memory_order_acquire)) {
+                        this_thread::yield();
+                    }
+                    return false;
+                }
+                continue;   // being removed: retry once it is unlinked
+            }
+
+            int highestLocked = -1;
+            SkipNode* previous = nullptr;
+            bool valid = true;
+            for (int level = 0; valid && level < levels; ++level) {
+                SkipNode* pred = preds[level];
+                SkipNode* succ = succs[level];
+                if (pred != previous) {
+                    pred->lock.lock();
+                    previous = pred;
+                }
+                highestLocked = level;
+                valid = !pred->marked.load(memory_order_acquire)
+                    && !succ->marked.load(memory_order_acquire)
+                    && pred->next[level].load(memory_order_acquire) == succ;
+            }
+
+            if (!valid) {
+                unlockAll(preds, highestLocked);
+                continue;
+            }
+
+            SkipNode* node = new SkipNode(course, levels, 0);
+            for (int level = 0; level < levels; ++level) {
+                node->next[level].store(succs[level], memory_order_relaxed);
+            }
+            for (int level = 0; level < levels; ++level) {
+                preds[level]->next[level].store(node, memory_order_release);
+            }
+            node->fullyLinked.store(true, memory_order_release);
+            unlockAll(preds, highestLocked);
+            count++;
+            return true;
+        }
+    }
+
+    // Removes a course; returns false if it is not present
+    bool Remove(const string& courseNumber) {
+        bool removed;
+        {
+            OperationScope scope(*this);
+            removed = removeNode(courseNumber);
+        }
+        if (removed) reclaim();
+        return removed;
+    }
+
+    /*
+    Visits live courses in sorted order without locking.
+    Concurrent edits may or may not be seen, but the visit never fails.
+    Nodes are not reclaimed while a visit runs.
+    */
+    template <typename Visitor>
+    void ForEach(const Visitor& visit) const {
+        OperationScope scope(*this);
+        SkipNode* node = head->next[0].load(memory_order_acquire);
+        while (node != tail) {
+            if (node->fullyLinked.load(memory_order_acquire)
+                && !node->marked.load(memory_order_acquire)) {
+                visit(node->course);
+            }
+            node = node->next[0].load(memory_order_acquire);
+        }
+    }
+
+private:
+    /*
+    The victim is locked and marked first, which is the moment the
+    removal takes effect, then unlinked from every level and retired.
+    */
+    bool removeNode(const string& courseNumber) {
+        SkipNode* victim = nullptr;
+        bool isMarked = false;
+        int topLevel = -1;
+        SkipNode* preds[kMaxLevel];
+        SkipNode* succs[kMaxLevel];
+
+        while (true) {
+            int found = findNode(courseNumber, preds, succs);
+            if (!isMarked) {
+                if (found == -1) return false;
+                victim = succs[found];
+                if (!victim->fullyLinked.load(memory_order_acquire)
+                    || victim->topLevel != found
+                    || victim->marked.load(memory_order_acquire)) {
+                    return false;
+                }
+                topLevel = victim->topLevel;
+                victim->lock.lock();
+                if (victim->marked.load(memory_order_acquire)) {
+                    victim->lock.unlock();
+                    return false;
+                }
+                victim->marked.store(true, memory_order_release);
+                isMarked = true;
+            }
+
+            int highestLocked = -1;
+            SkipNode* previous = nullptr;
+            bool valid = true;
+            for (int level = 0; valid && level <= topLevel; ++level) {
+                SkipNode* pred = preds[level];
+                if (pred != previous) {
+                    pred->lock.lock();
+                    previous = pred;
+                }
+                highestLocked = level;
+                valid = !pred->marked.load(memory_order_acquire)
+                    && pred->next[level].load(memory_order_acquire) == victim;
+            }
+
+            if (!valid) {
+                unlockAll(preds, highestLocked);
+                continue;
+            }
+
+            for (int level = topLevel; level >= 0; --level) {
+                preds[level]->next[level].store(
+                    victim->next[level].load(memory_order_acquire), memory_order_release);
+            }
+            victim->lock.unlock();
+            unlockAll(preds, highestLocked);
+            count--;
+
+            lock_guard<mutex> guard(retiredLock);
+            retired.push_back(victim);
+            return true;
+        }
+    }
+
+};
+
+// Output formats supported by ExportCatalog
+enum class ExportFormat { Json, Csv };
+
+// Courses serialized per export task; large enough to amortize scheduling
+const size_t kExportChunkSize = 4096;
+
+// Appends an unsigned integer using to_chars (no locale, no allocation)
+void AppendNumber(string& out, size_t value) {
+    char digits[24];
+    auto result = to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+// Appends a JSON string literal, escaping quotes, backslashes and control bytes
+void AppendJsonString(string& out, string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        }
+        else if (byte < 0x20) {
+            out += "\\u00";
+            out += hex[byte >> 4];
+            out += hex[byte & 0x0F];
+        }
+        else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+// Appends a CSV field, quoting it per RFC 4180 only when required
+void AppendCsvField(string& out, string_view text) {
+    if (text.find_first_of(",\"\r\n") == string_view::npos) {
+        out.append(text.data(), text.size());
+        return;
+    }
+    out += '"';
+    for (char c : text) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+/*
+Serializes one course with its prerequisites and derived fields:
+- prerequisiteCount: number of listed prerequisites
+- dependentCount: number of courses that list this course as a prerequisite
+- missingPrerequisites: listed prerequisites that are not in the catalog
+*/
+void AppendCourseRecord(
+    string& out,
+    ExportFormat format,
+    const Course& course,
+    size_t dependentCount,
+    const CourseLookupTable& lookupTable
+) {
+    if (format == ExportFormat::Json) {
+        out += "  {\"courseNumber\": ";
+        AppendJsonString(out, course.courseNumber);
+        out += ", \"courseTitle\": ";
+        AppendJsonString(out, course.courseTitle);
+        out += ", \"prerequisites\": [";
+        for (size_t i = 0; i < course.prerequisites.size(); ++i) {
+            if (i > 0) out += ", ";
+            AppendJsonString(out, course.prerequisites[i]);
+        }
+        out += "], \"prerequisiteCount\": ";
+        AppendNumber(out, course.prerequisites.size());
+        out += ", \"dependentCount\": ";
+        AppendNumber(out, dependentCount);
+        out += ", \"missingPrerequisites\": [";
+        bool first = true;
+        for (const auto& prereq : course.prerequisites) {
+            if (lookupTable.Find(prereq) != nullptr) continue;
+            if (!first) out += ", ";
+            AppendJsonString(out, prereq);
+            first = false;
+        }
+        out += "]}";
+    }
+    else {
+        // Prerequisite lists are joined with ';' so each course stays one row
+        AppendCsvField(out, course.courseNumber);
+        out += ',';
+        AppendCsvField(out, course.courseTitle);
+        out += ',';
+        string joined;
+        for (size_t i = 0; i < course.prerequisites.size(); ++i) {
+            if (i > 0) joined += ';';
+            joined += course.prerequisites[i];
+        }
+        AppendCsvField(out, joined);
+        out += ',';
+        AppendNumber(out, course.prerequisites.size());
+        out += ',';
+        AppendNumber(out, dependentCount);
+        out += ',';
+        joined.clear();
+        for (const auto& prereq : course.prerequisites) {
+            if (lookupTable.Find(prereq) != nullptr) continue;
+            if (!joined.empty()) joined += ';';
+            joined += prereq;
+        }
+        AppendCsvField(out, joined);
+    }
+}
+
+/*
+Exports the whole catalog in course number order as JSON or CSV.
+The sorted course list is cut into contiguous key ranges; each range is
+serialized into its own buffer on the shared scheduler and the buffers
+are written in range order, so the file is identical to a serial export.
+Returns false when the file cannot be written.
+*/
+bool ExportCatalog(
+    const string& filename,
+    ExportFormat format,
+    const CourseCatalog& catalog,
+    TaskScheduler& scheduler
+) {
+    auto started = chrono::steady_clock::now();
+
+    vector<const Course*> courses;
+    catalog.Ordered().CollectInOrder(courses);
+    const CourseLookupTable& lookupTable = catalog.lookupTable;
+    const auto& dependentsIndex = catalog.Dependents();
+
+    size_t chunkCount = (courses.size() + kExportChunkSize - 1) / kExportChunkSize;
+    vector<string> chunks(chunkCount);
+    scheduler.ParallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            size_t first = chunk * kExportChunkSize;
+            size_t last = min(first + kExportChunkSize, courses.size());
+            string& out = chunks[chunk];
+            out.reserve((last - first) * 128);
+            for (size_t i = first; i < last; ++i) {
+                if (format == ExportFormat::Json && i > 0) out += ",\n";
+                auto found = dependentsIndex.find(courses[i]->courseNumber);
+                size_t dependents = (found == dependentsIndex.end()) ? 0 : found->second.size();
+                AppendCourseRecord(out, format, *courses[i], dependents, lookupTable);
+                if (format == ExportFormat::Csv) out += '\n';
+            }
+        }
+    });
+
+    ofstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        cout << "Error: Unable to write file " << filename << endl;
+        return false;
+    }
+
+    size_t bytes = 0;
+    if (format == ExportFormat::Json) {
+        file << "[\n";
+    }
+    else {
+        file << "courseNumber,courseTitle,prerequisites,prerequisiteCount,"
+            "dependentCount,missingPrerequisites\n";
+    }
+    for (const auto& chunk : chunks) {
+        if (!file.write(chunk.data(), static_cast<streamsize>(chunk.size()))) break;
+        bytes += chunk.size();
+    }
+    if (format == ExportFormat::Json) file << "\n]\n";
+    file.close();
+
+    // A full disk or I/O error shows up as a failed write or close
+    if (file.fail()) {
+        cout << "Error: Failed writing " << filename << endl;
+        return false;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    cout << "Exported " << courses.size() << " courses (" << bytes << " bytes) to "
+        << filename << " in " << seconds * 1000.0 << " ms";
+    if (seconds > 0) cout << " (" << bytes / seconds / 1e6 << " MB/s)";
+    cout << endl;
+    return true;
+}
+
+/*
+Fixed-size set of course ids stored one bit per course.
+Set operations work 64 courses at a time, and counting members is a
+popcount per word, which keeps eligibility and audit queries cheap.
+*/
+class CourseBitset {
+private:
+    vector<uint64_t> words;
+
+public:
+    CourseBitset() {}
+
+    explicit CourseBitset(size_t courseCount) : words((courseCount + 63) / 64, 0) {}
+
+    void Set(uint32_t id) { words[id >> 6] |= 1ULL << (id & 63); }
+
+    bool Test(uint32_t id) const { return (words[id >> 6] >> (id & 63)) & 1; }
+
+    size_t Count() const {
+        size_t total = 0;
+        for (uint64_t word : words) total += bitset<64>(word).count();
+        return total;
+    }
+
+    // True when every member of other is also a member of this set
+    bool Contains(const CourseBitset& other) const {
+        for (size_t i = 0; i < words.size(); ++i) {
+            if ((other.words[i] & ~words[i]) != 0) return false;
+        }
+        return true;
+    }
+
+    const vector<uint64_t>& Words() const { return words; }
+    vector<uint64_t>& Words() { return words; }
+};
+
+// Id returned when a course number is not in the catalog
+const uint32_t kNoCourseId = numeric_limits<uint32_t>::max();
+
+/*
+Dense course ids for analytics.
+Ids follow sorted course number order (0 .. n-1), so per-course data can
+live in plain arrays and sets of courses fit in bitsets. Prerequisites
+are resolved to ids once; missing prerequisites are left out.
+The index records the catalog revision it was built from and must be
+rebuilt after the catalog changes.
+*/
+class CourseIdIndex {
+private:
+    vector<const Course*> courses;
+    unordered_map<string_view, uint32_t> ids;
+    vector<vector<uint32_t>> prerequisiteIds;
+    uint64_t revision;
+    bool built;
+
+public:
+    CourseIdIndex() : revision(0), built(false) {}
+
+    void Build(const CourseCatalog& catalog) {
+        courses.clear();
+        catalog.Ordered().CollectInOrder(courses);
+
+        ids.clear();
+        ids.reserve(courses.size());
+        for (size_t i = 0; i < courses.size(); ++i) {
+            ids.emplace(courses[i]->courseNumber, static_cast<uint32_t>(i));
+        }
+
+        prerequisiteIds.assign(courses.size(), vector<uint32_t>());
+        for (size_t i = 0; i < courses.size(); ++i) {
+            for (const auto& prereq : courses[i]->prerequisites) {
+                uint32_t id = Find(prereq);
+                if (id != kNoCourseId) prerequisiteIds[i].push_back(id);
+            }
+        }
+
+        revision = catalog.revision;
+        built = true;
+    }
+
+    // True when the index reflects the catalog's current contents
+    bool IsCurrent(const CourseCatalog& catalog) const {
+        return built && revision == catalog.revision;
+    }
+
+    uint64_t Revision() const { return revision; }
+
+    size_t Size() const { return courses.size(); }
+
+    uint32_t Find(string_view courseNumber) const {
+        auto found = ids.find(courseNumber);
+        return found == ids.end() ? kNoCourseId : found->second;
+    }
+
+    const Course& GetCourse(uint32_t id) const { return *courses[id]; }
+
+    const vector<uint32_t>& Prerequisites(uint32_t id) const { return prerequisiteIds[id]; }
+};
+
+/*
+Lists the courses a student may take next: not yet completed, and every
+prerequisite found in the catalog already completed.
+*/
+vector<uint32_t> EligibleCourses(const CourseIdIndex& courseIds, const CourseBitset& completed) {
+    vector<uint32_t> eligible;
+    for (uint32_t id = 0; id < courseIds.Size(); ++id) {
+        if (completed.Test(id)) continue;
+        const auto& prereqs = courseIds.Prerequisites(id);
+        bool ready = all_of(prereqs.begin(), prereqs.end(),
+            [&](uint32_t prereq) { return completed.Test(prereq); });
+        if (ready) eligible.push_back(id);
+    }
+    return eligible;
+}
+
+// Index returned when a student id is not in the transcripts
+const uint32_t kNoStudent = numeric_limits<uint32_t>::max();
+
+/*
+Completed courses for every student, loaded from a transcript CSV.
+Row format: student id, course number, term, grade.
+Passed courses are stored as sorted course id arrays packed back to back
+(offsets[s] .. offsets[s + 1]), which is far smaller than one bitset per
+student for sparse transcripts; CompletedSet expands one student into a
+bitset when a query needs fast membership tests.
+*/
+class StudentTranscripts {
+private:
+    vector<string> studentIds;
+    unordered_map<string, uint32_t> studentIndex;
+    vector<size_t> offsets;
+    vector<uint32_t> completedIds;
+    size_t courseCount;
+    uint64_t catalogRevision;
+
+    // Grades that do not complete a course, in any letter case
+    static bool isPassingGrade(string_view grade) {
+        if (grade.empty()) return false;
+        if (grade.size() > 2) return true;
+        char upper[2];
+        memcpy(upper, grade.data(), grade.size());
+        UppercaseAscii(upper, grade.size());
+        string_view code(upper, grade.size());
+        return !(code == "F" || code == "W" || code == "I" || code == "NP" || code == "U");
+    }
+
+    // Splits one row into at most count comma-separated fields
+    static size_t splitFields(string_view row, string_view* fields, size_t count) {
+        size_t used = 0;
+        while (used < count) {
+            size_t comma = row.find(',');
+            fields[used++] = TrimKeyWhitespace(row.substr(0, comma));
+            if (comma == string_view::npos) break;
+            row.remove_prefix(comma + 1);
+        }
+        return used;
+    }
+
+public:
+    StudentTranscripts() : offsets(1, 0), courseCount(0), catalogRevision(0) {}
+
+    /*
+    Loads a transcript file in parallel.
+    1. The file is read into memory and cut into chunks at line breaks.
+    2. Each chunk resolves course numbers to ids and routes every row
+       to a partition chosen by a hash of the student id.
+    3. Each partition builds the completed-course arrays of its own
+       students, so no two tasks ever touch the same student.
+    Every well-formed row registers its student, so a student with no
+    passed course is still known. Passed rows with unknown course
+    numbers are counted and add no course; rows without all four fields
+    are reported with their line and skipped. A UTF-8 byte order mark at
+    the start of the file is skipped.
+    */
+    bool Load(const string& filename, const CourseIdIndex& courseIds, TaskScheduler& scheduler) {
+        string data;
+        {
+            // Sized once and read in place: a large file is never held twice
+            ifstream file(filename, ios::binary | ios::ate);
+            if (!file.is_open()) {
+                cout << "Error: Unable to open file " << filename << endl;
+                return false;
+            }
+            streamoff size = file.tellg();
+            if (size < 0) {
+                cout << "Error: Unable to read file " << filename << endl;
+                return false;
+            }
+            data.resize(static_cast<size_t>(size));
+            file.seekg(0);
+            if (size > 0 && !file.read(&data[0], size)) {
+                cout << "Error: Unable to read file " << filename << endl;
+                return false;
+            }
+        }
+
+        auto started = chrono::steady_clock::now();
+        const size_t chunkBytes = 1 << 20;
+        size_t firstByte = data.compare(0, kUtf8ByteOrderMark.size(), kUtf8ByteOrderMark) == 0
+            ? kUtf8ByteOrderMark.size() : 0;
+        vector<pair<size_t, size_t>> chunks;
+        for (size_t begin = firstByte; begin < data.size();) {
+            size_t end = min(begin + chunkBytes, data.size());
+            while (end < data.size() && data[end - 1] != '\n') end++;
+            chunks.emplace_back(begin, end);
+            begin = end;
+        }
+
+        struct Row {
+            string_view student;
+            uint32_t course;   // kNoCourseId when the row completes nothing
+        };
+        size_t partitionCount = scheduler.WorkerCount() * 4;
+        vector<vector<vector<Row>>> routed(chunks.size(), vector<vector<Row>>(partitionCount));
+        vector<size_t> rowCounts(chunks.size(), 0);
+        vector<size_t> unknownCounts(chunks.size(), 0);
+        vector<size_t> lineCounts(chunks.size(), 0);
+        vector<vector<CsvRowIssue>> chunkIssues(chunks.size());   // lines local to the chunk
+        hash<string_view> hashStudent;
+
+        scheduler.ParallelFor(0, chunks.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t chunk = begin; chunk < end; ++chunk) {
+                string_view text(data.data() + chunks[chunk].first,
+                    chunks[chunk].second - chunks[chunk].first);
+                while (!text.empty()) {
+                    size_t newline = text.find('\n');
+                    string_view row = text.substr(0, newline);
+                    uint64_t offset = static_cast<uint64_t>(row.data() - data.data());
+                    text.remove_prefix(newline == string_view::npos ? text.size() : newline + 1);
+                    lineCounts[chunk]++;
+                    if (TrimKeyWhitespace(row).empty()) continue;
+
+                    string_view fields[4];
+                    if (splitFields(row, fields, 4) < 4 || fields[0].empty()) {
+                        chunkIssues[chunk].push_back(CsvRowIssue{
+                            CsvPosition{ offset, lineCounts[chunk] }, offset,
+                            "expected student id, course, term and grade" });
+                        continue;
+                    }
+                    rowCounts[chunk]++;
+                    uint32_t course = kNoCourseId;
+                    if (isPassingGrade(fields[3])) {
+                        char buffer[kMaxCourseKeyLength];
+                        size_t length = NormalizeCourseKey(fields[1], buffer, sizeof(buffer));
+                        if (length > 0) course = courseIds.Find(string_view(buffer, length));
+                        if (course == kNoCourseId) unknownCounts[chunk]++;
+                    }
+                    size_t partition = hashStudent(fields[0]) % partitionCount;
+                    routed[chunk][partition].push_back(Row{ fields[0], course });
+                }
+            }
+        });
+
+        struct Partition {
+            vector<string> students;
+            vector<vector<uint32_t>> completed;
+        };
+        vector<Partition> partitions(partitionCount);
+        scheduler.ParallelFor(0, partitionCount, 1, [&](size_t begin, size_t end) {
+            for (size_t p = begin; p < end; ++p) {
+                unordered_map<string_view, uint32_t> local;
+                Partition& partition = partitions[p];
+                for (const auto& chunkRows : routed) {
+                    for (const Row& row : chunkRows[p]) {
+                        auto inserted = local.emplace(row.student,
+                            static_cast<uint32_t>(partition.students.size()));
+                        if (inserted.second) {
+                            partition.students.emplace_back(row.student);
+                            partition.completed.emplace_back();
+                        }
+                        if (row.course != kNoCourseId) {
+                            partition.completed[inserted.first->second].push_back(row.course);
+                        }
+                    }
+                }
+                for (auto& courses : partition.completed) {
+                    sort(courses.begin(), courses.end());
+                    courses.erase(unique(courses.begin(), courses.end()), courses.end());
+                }
+            }
+        });
+
+        // Concatenate the partitions into the packed layout
+        studentIds.clear();
+        studentIndex.clear();
+        offsets.assign(1, 0);
+        completedIds.clear();
+        for (auto& partition : partitions) {
+            for (size_t i = 0; i < partition.students.size(); ++i) {
+                studentIndex.emplace(partition.students[i], static_cast<uint32_t>(studentIds.size()));
+                studentIds.push_back(move(partition.students[i]));
+                completedIds.insert(completedIds.end(),
+                    partition.completed[i].begin(), partition.completed[i].end());
+                offsets.push_back(completedIds.size());
+            }
+        }
+        courseCount = courseIds.Size();
+        catalogRevision = courseIds.Revision();
+
+        size_t rows = 0;
+        size_t unknown = 0;
+        uint64_t lineBase = 0;
+        vector<CsvRowIssue> issues;
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            rows += rowCounts[i];
+            unknown += unknownCounts[i];
+            for (CsvRowIssue issue : chunkIssues[i]) {
+                issue.position.line += lineBase;
+                issues.push_back(issue);
+            }
+            lineBase += lineCounts[i];
+        }
+        ReportMalformedRows(filename, issues);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        cout << "Loaded " << rows << " transcript rows for " << studentIds.size()
+            << " students in " << seconds * 1000.0 << " ms";
+        if (unknown > 0) cout << " (" << unknown << " passed rows with unknown courses ignored)";
+        cout << endl;
+        return true;
+    }
+
+    size_t StudentCount() const { return studentIds.size(); }
+
+    // Catalog revision the stored course ids refer to
+    uint64_t CatalogRevision() const { return catalogRevision; }
+
+    // Index of a student, or kNoStudent when the student is unknown
+    uint32_t FindStudent(const string& studentId) const {
+        auto found = studentIndex.find(studentId);
+        return found == studentIndex.end() ? kNoStudent : found->second;
+    }
+
+    const string& StudentId(uint32_t student) const { return studentIds[student]; }
+
+    // Sorted ids of the courses a student has passed
+    pair<const uint32_t*, const uint32_t*> CompletedIds(uint32_t student) const {
+        return { completedIds.data() + offsets[student], completedIds.data() + offsets[student + 1] };
+    }
+
+    CourseBitset CompletedSet(uint32_t student) const {
+        CourseBitset completed(courseCount);
+        auto range = CompletedIds(student);
+        for (const uint32_t* id = range.first; id != range.second; ++id) completed.Set(*id);
+        return completed;
+    }
+};
+
+/*
+Prints a student's completed courses and the courses they may take next.
+*/
+void PrintStudentEligibility(
+    const string& studentId,
+    const StudentTranscripts& transcripts,
+    const CourseIdIndex& courseIds
+) {
+    uint32_t student = transcripts.FindStudent(studentId);
+    if (student == kNoStudent) {
+        cout << "Student not found." << endl;
+        return;
+    }
+
+    CourseBitset completed = transcripts.CompletedSet(student);
+    cout << "Student " << studentId << " has completed " << completed.Count() << " courses." << endl;
+
+    vector<uint32_t> eligible = EligibleCourses(courseIds, completed);
+    if (eligible.empty()) {
+        cout << "No further courses are available." << endl;
+        return;
+    }
+    cout << "Eligible courses:" << endl;
+    for (uint32_t id : eligible) {
+        const Course& course = courseIds.GetCourse(id);
+        cout << course.courseNumber << ", " << course.courseTitle << endl;
+    }
+}
+
+/*
+Transitive "unlocks" closure of the prerequisite graph.
+unlocks[c] holds every course that requires c directly or indirectly.
+Courses are grouped by height (longest chain of dependents below them):
+a course's dependents all have a smaller height, so every height level
+can be computed in parallel once the levels below it are done, each
+course OR-ing its dependents' bitsets 64 courses per instruction.
+Courses on a prerequisite cycle have no height and unlock nothing.
+*/
+class PrerequisiteClosure {
+private:
+    vector<CourseBitset> unlocks;
+    vector<vector<uint32_t>> dependents;
+    size_t cyclicCourses;
+    uint64_t revision;
+
+public:
+    PrerequisiteClosure() : cyclicCourses(0), revision(0) {}
+
+    void Build(const CourseIdIndex& courseIds, TaskScheduler& scheduler) {
+        size_t count = courseIds.Size();
+        dependents.assign(count, vector<uint32_t>());
+        for (uint32_t id = 0; id < count; ++id) {
+            for (uint32_t prereq : courseIds.Prerequisites(id)) {
+                dependents[prereq].push_back(id);
+            }
+        }
+
+        // Peel courses with no remaining dependents, one height level at a time
+        vector<size_t> remaining(count);
+        vector<vector<uint32_t>> levels(1);
+        for (uint32_t id = 0; id < count; ++id) {
+            remaining[id] = dependents[id].size();
+            if (remaining[id] == 0) levels[0].push_back(id);
+        }
+        size_t placed = 0;
+        for (size_t level = 0; level < levels.size(); ++level) {
+            placed += levels[level].size();
+            for (uint32_t id : levels[level]) {
+                for (uint32_t prereq : courseIds.Prerequisites(id)) {
+                    if (--remaining[prereq] == 0) {
+                        if (levels.size() == level + 1) levels.emplace_back();
+                        levels[level + 1].push_back(prereq);
+                    }
+                }
+            }
+        }
+        cyclicCourses = count - placed;
+
+        unlocks.assign(count, CourseBitset(count));
+        for (const auto& level : levels) {
+            scheduler.ParallelFor(0, level.size(), 64, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    uint32_t id = level[i];
+                    vector<uint64_t>& words = unlocks[id].Words();
+                    for (uint32_t dependent : dependents[id]) {
+                        unlocks[id].Set(dependent);
+                        const vector<uint64_t>& below = unlocks[dependent].Words();
+                        for (size_t w = 0; w < words.size(); ++w) words[w] |= below[w];
+                    }
+                }
+            });
+        }
+        revision = courseIds.Revision();
+    }
+
+    uint64_t Revision() const { return revision; }
+
+    size_t CyclicCourses() const { return cyclicCourses; }
+
+    const CourseBitset& Unlocks(uint32_t id) const { return unlocks[id]; }
+};
+
+// A prerequisite edge implied by another prerequisite of the same course
+struct RedundantPrerequisite {
+    uint32_t course;
+    uint32_t prerequisite;
+    uint32_t impliedBy;   // equal to prerequisite when the course lists it twice
+};
+
+/*
+Transitive reduction of the prerequisite graph.
+First ancestors[c] (every course needed before c, directly or not) is
+built level by level from the top: a course's prerequisites all sit on
+lower depth levels, so each level is filled in parallel by OR-ing the
+prerequisites' bitsets. Then the prerequisite p of course c is
+redundant when another prerequisite q of c already requires p.
+Removing every such edge keeps exactly the same "must take before"
+relation while shrinking the graph. Courses on cycles are skipped.
+*/
+vector<RedundantPrerequisite> FindRedundantPrerequisites(
+    const CourseIdIndex& courseIds,
+    TaskScheduler& scheduler,
+    size_t& cyclicCourses
+) {
+    size_t count = courseIds.Size();
+    vector<vector<uint32_t>> dependents(count);
+    vector<size_t> remaining(count);
+    vector<vector<uint32_t>> levels(1);
+    for (uint32_t id = 0; id < count; ++id) {
+        for (uint32_t prereq : courseIds.Prerequisites(id)) dependents[prereq].push_back(id);
+        remaining[id] = courseIds.Prerequisites(id).size();
+        if (remaining[id] == 0) levels[0].push_back(id);
+    }
+
+    size_t placed = 0;
+    for (size_t level = 0; level < levels.size(); ++level) {
+        placed += levels[level].size();
+        for (uint32_t id : levels[level]) {
+            for (uint32_t dependent : dependents[id]) {
+                if (--remaining[dependent] == 0) {
+                    if (levels.size() == level + 1) levels.emplace_back();
+                    levels[level + 1].push_back(dependent);
+                }
+            }
+        }
+    }
+    cyclicCourses = count - placed;
+
+    vector<CourseBitset> ancestors(count, CourseBitset(count));
+    for (const auto& level : levels) {
+        scheduler.ParallelFor(0, level.size(), 64, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t id = level[i];
+                vector<uint64_t>& words = ancestors[id].Words();
+                for (uint32_t prereq : courseIds.Prerequisites(id)) {
+                    ancestors[id].Set(prereq);
+                    const vector<uint64_t>& above = ancestors[prereq].Words();
+                    for (size_t w = 0; w < words.size(); ++w) words[w] |= above[w];
+                }
+            }
+        });
+    }
+
+    // Every acyclic course is checked independently against its own prerequisites
+    vector<vector<RedundantPrerequisite>> found(count);
+    scheduler.ParallelFor(0, count, 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t id = static_cast<uint32_t>(i);
+            if (remaining[id] != 0) continue;   // on or behind a cycle
+            const auto& prereqs = courseIds.Prerequisites(id);
+            for (size_t a = 0; a < prereqs.size(); ++a) {
+                uint32_t candidate = prereqs[a];
+                for (size_t b = 0; b < prereqs.size(); ++b) {
+                    if (a == b) continue;
+                    bool duplicate = prereqs[b] == candidate && b < a;
+                    if (duplicate || ancestors[prereqs[b]].Test(candidate)) {
+                        found[id].push_back(RedundantPrerequisite{ id, candidate, prereqs[b] });
+                        break;
+                    }
+                }
+            }
+        }
+    });
+
+    vector<RedundantPrerequisite> redundant;
+    for (const auto& list : found) redundant.insert(redundant.end(), list.begin(), list.end());
+    return redundant;
+}
+
+/*
+Reports redundant prerequisites and optionally removes them.
+Each affected course is rewritten through ApplyCatalogEdit, so removals
+are journaled and published like any other edit; rewriting stops at the
+first edit the journal refuses. Returns the number of edges removed.
+*/
+size_t ReduceCatalogPrerequisites(
+    CourseCatalog& catalog,
+    CatalogJournal& catalogJournal,
+    ReplicationPublisher& publisher,
+    const CourseIdIndex& courseIds,
+    TaskScheduler& scheduler,
+    bool removeEdges
+) {
+    size_t cyclicCourses = 0;
+    vector<RedundantPrerequisite> redundant =
+        FindRedundantPrerequisites(courseIds, scheduler, cyclicCourses);
+
+    if (cyclicCourses > 0) {
+        cout << "Warning: " << cyclicCourses
+            << " courses are on or behind prerequisite cycles and were not checked." << endl;
+    }
+    for (const auto& edge : redundant) {
+        const Course& course = courseIds.GetCourse(edge.course);
+        const string& prereq = courseIds.GetCourse(edge.prerequisite).courseNumber;
+        cout << course.courseNumber << ": " << prereq;
+        if (edge.impliedBy == edge.prerequisite) {
+            cout << " is listed more than once" << endl;
+        }
+        else {
+            cout << " is already required by "
+                << courseIds.GetCourse(edge.impliedBy).courseNumber << endl;
+        }
+    }
+    cout << redundant.size() << " redundant prerequisite edges found." << endl;
+    if (!removeEdges || redundant.empty()) return 0;
+
+    // Copy the reduced records first: edits invalidate the id index
+    vector<Course> rewritten;
+    vector<size_t> edgesPerCourse;
+    for (size_t i = 0; i < redundant.size();) {
+        uint32_t id = redundant[i].course;
+        Course course = courseIds.GetCourse(id);
+        vector<string> drop;
+        for (; i < redundant.size() && redundant[i].course == id; ++i) {
+            drop.push_back(courseIds.GetCourse(redundant[i].prerequisite).courseNumber);
+        }
+
+        // Remove one listed occurrence per redundant edge
+        for (const string& prereq : drop) {
+            auto entry = find(course.prerequisites.begin(), course.prerequisites.end(), prereq);
+            if (entry != course.prerequisites.end()) course.prerequisites.erase(entry);
+        }
+        rewritten.push_back(move(course));
+        edgesPerCourse.push_back(drop.size());
+    }
+
+    size_t removed = 0;
+    size_t courses = 0;
+    for (size_t i = 0; i < rewritten.size(); ++i) {
+        if (ApplyCatalogEdit(catalog, catalogJournal, publisher,
+            JournalRecord{ JournalOp::Upsert, rewritten[i] }) != EditResult::Applied) {
+            break;
+        }
+        removed += edgesPerCourse[i];
+        courses++;
+    }
+    cout << "Removed " << removed << " redundant prerequisite edges from "
+        << courses << " courses." << endl;
+    return removed;
+}
+
+// One ranked recommendation
+struct Recommendation {
+    uint32_t course;
+    size_t unlockValue;   // target courses still to take that this course leads to
+};
+
+/*
+Ranks the courses a student can take now by how many still-needed
+target courses each one (transitively) unlocks:
+    popcount(unlocks[c] & target & ~completed)
+Ties are broken by course number order. Returns at most limit entries.
+*/
+vector<Recommendation> RecommendCourses(
+    const CourseIdIndex& courseIds,
+    const PrerequisiteClosure& closure,
+    const CourseBitset& completed,
+    const CourseBitset& target,
+    size_t limit
+) {
+    vector<Recommendation> ranked;
+    const vector<uint64_t>& done = completed.Words();
+    const vector<uint64_t>& wanted = target.Words();
+    for (uint32_t id : EligibleCourses(courseIds, completed)) {
+        const vector<uint64_t>& reach = closure.Unlocks(id).Words();
+        size_t value = 0;
+        for (size_t w = 0; w < reach.size(); ++w) {
+            value += bitset<64>(reach[w] & wanted[w] & ~done[w]).count();
+        }
+        ranked.push_back(Recommendation{ id, value });
+    }
+
+    size_t keep = min(limit, ranked.size());
+    partial_sort(ranked.begin(), ranked.begin() + keep, ranked.end(),
+        [](const Recommendation& a, const Recommendation& b) {
+            if (a.unlockValue != b.unlockValue) return a.unlockValue > b.unlockValue;
+            return a.course < b.course;
+        });
+    ranked.resize(keep);
+    return ranked;
+}
+
+/*
+Builds the target degree set from a list of course numbers separated by
+spaces or commas. An empty list targets every course in the catalog.
+Unknown course numbers are reported and ignored.
+*/
+CourseBitset ParseTargetCourses(const string& input, const CourseIdIndex& courseIds) {
+    CourseBitset target(courseIds.Size());
+    bool any = false;
+    string token;
+    auto addToken = [&]() {
+        if (token.empty()) return;
+        CanonicalizeCourseKey(token);
+        uint32_t id = courseIds.Find(token);
+        if (id == kNoCourseId) {
+            cout << "Ignoring unknown target course " << token << endl;
+        }
+        else {
+            target.Set(id);
+            any = true;
+        }
+        token.clear();
+    };
+    for (char c : input) {
+        if (c == ',' || c == ' ' || c == '\t') addToken();
+        else token += c;
+    }
+    addToken();
+
+    if (!any) {
+        for (uint32_t id = 0; id < courseIds.Size(); ++id) target.Set(id);
+    }
+    return target;
+}
+
+// Number of recommendations printed or exported per student
+const size_t kRecommendationsPerStudent = 5;
+
+/*
+Runs the recommender for every student on the shared scheduler and
+writes studentId,rank,courseNumber,unlockValue rows to a CSV file.
+Students are split into ranges whose output buffers are written in order.
+*/
+bool ExportRecommendations(
+    const string& filename,
+    const StudentTranscripts& transcripts,
+    const CourseIdIndex& courseIds,
+    const PrerequisiteClosure& closure,
+    const CourseBitset& target,
+    TaskScheduler& scheduler
+) {
+    auto started = chrono::steady_clock::now();
+    const size_t studentsPerChunk = 1024;
+    size_t studentCount = transcripts.StudentCount();
+    size_t chunkCount = (studentCount + studentsPerChunk - 1) / studentsPerChunk;
+    vector<string> chunks(chunkCount);
+
+    scheduler.ParallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            string& out = chunks[chunk];
+            size_t last = min((chunk + 1) * studentsPerChunk, studentCount);
+            for (size_t s = chunk * studentsPerChunk; s < last; ++s) {
+                uint32_t student = static_cast<uint32_t>(s);
+                vector<Recommendation> ranked = RecommendCourses(courseIds, closure,
+                    transcripts.CompletedSet(student), target, kRecommendationsPerStudent);
+                for (size_t r = 0; r < ranked.size(); ++r) {
+                    AppendCsvField(out, transcripts.StudentId(student));
+                    out += ',';
+                    AppendNumber(out, r + 1);
+                    out += ',';
+                    AppendCsvField(out, courseIds.GetCourse(ranked[r].course).courseNumber);
+                    out += ',';
+                    AppendNumber(out, ranked[r].unlockValue);
+                    out += '\n';
+                }
+            }
+        }
+    });
+
+    ofstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        cout << "Error: Unable to write file " << filename << endl;
+        return false;
+    }
+    file << "studentId,rank,courseNumber,unlockValue\n";
+    for (const auto& chunk : chunks) {
+        if (!file.write(chunk.data(), static_cast<streamsize>(chunk.size()))) break;
+    }
+    file.close();
+    if (file.fail()) {
+        cout << "Error: Failed writing " << filename << endl;
+        return false;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    cout << "Wrote recommendations for " << studentCount << " students to " << filename
+        << " in " << seconds * 1000.0 << " ms" << endl;
+    return true;
+}
+
+// Number of courses shown per page of the course list
+const size_t kCoursesPerPage = 50;
+
+/*
+Prints one page of the sorted course list.
+Input is either a one-based page number or a course number, in which
+case the page containing that course is shown.
+Uses the tree's subtree sizes so only the requested page is visited;
+course numbers rejected by the lookup table's filter skip the tree.
+*/
+void PrintCoursePage(const string& input, const CourseBST& bst,
+    const CourseLookupTable& lookupTable) {
+    size_t total = bst.Size();
+    size_t pageCount = (total + kCoursesPerPage - 1) / kCoursesPerPage;
+    size_t page = 0;
+    if (total == 0) {
+        cout << "The course list is empty." << endl;
+        return;
+    }
+
+    string_view trimmed = TrimKeyWhitespace(input);
+    bool numeric = !trimmed.empty()
+        && all_of(trimmed.begin(), trimmed.end(),
+            [](char c) { return c >= '0' && c <= '9'; });
+
+    if (numeric) {
+        page = static_cast<size_t>(strtoull(string(trimmed).c_str(), nullptr, 10));
+        if (page == 0 || page > pageCount) {
+            cout << "Page must be between 1 and " << pageCount << "." << endl;
+            return;
+        }
+        page--;
+    }
+    else {
+        string courseNumber(trimmed);
+        CanonicalizeCourseKey(courseNumber);
+        if (!lookupTable.MayContain(courseNumber)) {
+            cout << "Course not found." << endl;
+            return;
+        }
+        size_t rank = bst.Rank(courseNumber);
+        const Course* course = bst.Select(rank);
+        if (course == nullptr || course->courseNumber != courseNumber) {
+            cout << "Course not found." << endl;
+            return;
+        }
+        cout << courseNumber << " is course " << rank + 1
+            << " of " << total << "." << endl;
+        page = rank / kCoursesPerPage;
+    }
+
+    cout << "\nPage " << page + 1 << " of " << pageCount << ":\n" << endl;
+    bst.PrintRange(page * kCoursesPerPage, kCoursesPerPage);
+}
+
+/*
+Benchmarks the concurrent index under mixed read/write workloads.
+Every thread runs the same number of operations on random course numbers
+drawn from twice the preloaded key count, so inserts and removes keep
+the index near its starting size. Benchmark threads are plain threads
+rather than scheduler tasks because each one runs for the whole test.
+*/
+void RunConcurrentIndexBenchmark(unsigned threadCount) {
+    const size_t keyCount = 1 << 18;
+    const size_t operationsPerThread = 1 << 18;
+    const int readPercents[] = { 100, 95, 80, 50 };
+
+    vector<string> keys(keyCount * 2);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = "CS" + to_string(100000 + i);
+    }
+
+    cout << "Concurrent index benchmark: " << threadCount << " threads, "
+        << keyCount << " preloaded courses" << endl;
+
+    for (int readPercent : readPercents) {
+        ConcurrentCourseIndex index;
+        for (size_t i = 0; i < keys.size(); i += 2) {
+            index.Insert(Course{ keys[i], "Benchmark course", {} });
+        }
+
+        atomic<size_t> hits(0);
+        vector<thread> threads;
+        auto started = chrono::steady_clock::now();
+        for (unsigned t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&, t]() {
+                mt19937_64 generator(t + 1);
+                size_t localHits = 0;
+                for (size_t op = 0; op < operationsPerThread; ++op) {
+                    uint64_t random = generator();
+                    const string& key = keys[random % keys.size()];
+                    int roll = static_cast<int>((random >> 32) % 100);
+                    if (roll < readPercent) {
+                        if (index.Find(key)) localHits++;
+                    }
+                    else if (roll % 2 == 0) {
+                        index.Insert(Course{ key, "Benchmark course", {} });
+                    }
+                    else {
+                        index.Remove(key);
+                    }
+                }
+                hits += localHits;
+            });
+        }
+        for (auto& worker : threads) worker.join();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+        double operations = static_cast<double>(operationsPerThread) * threadCount;
+        cout << "  " << readPercent << "% reads / " << 100 - readPercent << "% writes: "
+            << operations / seconds / 1e6 << " Mops/s (" << hits << " lookups found, "
+            << index.Size() << " courses at end)" << endl;
+    }
+}
+
+/*
+Counts hardware cache misses of the calling thread using perf_event_open.
+Only on Linux, and only where the kernel allows user-space counters;
+Available() reports whether the numbers mean anything.
+*/
+class CacheMissCounter {
+private:
+    int fd;
+
+public:
+    CacheMissCounter() : fd(-1) {
+#ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    bool Available() const { return fd >= 0; }
+
+    void Start() {
+#ifdef __linux__
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    uint64_t Stop() {
+        uint64_t misses = 0;
+#ifdef __linux__
+        if (fd < 0) return 0;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &misses, sizeof(misses)) != static_cast<ssize_t>(sizeof(misses))) misses = 0;
+#endif
+        return misses;
+    }
+};
+
+/*
+Benchmarks the access-frequency layout on a skewed query trace.
+Courses are inserted in random order, so the tree nodes and map records
+of popular courses end up scattered across the heap. Queries follow a
+Zipfian distribution (exponent 0.99) over a random ranking of courses.
+One trace trains the access profile; a second trace from the same
+distribution is then run against the insertion-ordered structures and
+the reorganized index, reporting time and cache misses per lookup.
+*/
+void RunLayoutBenchmark() {
+    const size_t keyCount = 1 << 18;
+    const size_t queryCount = 1 << 21;
+    const double exponent = 0.99;
+
+    vector<string> keys(keyCount);
+    for (size_t i = 0; i < keyCount; ++i) {
+        keys[i] = "CS" + to_string(100000 + i);
+    }
+
+    mt19937_64 generator(42);
+    vector<size_t> insertion(keyCount);
+    for (size_t i = 0; i < keyCount; ++i) insertion[i] = i;
+    shuffle(insertion.begin(), insertion.end(), generator);
+
+    CourseCatalog catalog;
+    catalog.Ordered();   // build the empty tree now so it grows in insertion order
+    for (size_t i : insertion) {
+        UpsertCourse(catalog, Course{ keys[i], "Benchmark course with a heap-allocated title", {} });
+    }
+
+    // Popularity rank r maps to a random course; CDF lookup draws ranks
+    vector<size_t> rankToKey(insertion);
+    shuffle(rankToKey.begin(), rankToKey.end(), generator);
+    vector<double> cdf(keyCount);
+    double total = 0;
+    for (size_t r = 0; r < keyCount; ++r) {
+        total += 1.0 / pow(static_cast<double>(r + 1), exponent);
+        cdf[r] = total;
+    }
+    auto makeTrace = [&](uint64_t seed) {
+        mt19937_64 random(seed);
+        uniform_real_distribution<double> uniform(0.0, total);
+        vector<const string*> trace(queryCount);
+        for (auto& query : trace) {
+            size_t rank = lower_bound(cdf.begin(), cdf.end(), uniform(random)) - cdf.begin();
+            query = &keys[rankToKey[min(rank, keyCount - 1)]];
+        }
+        return trace;
+    };
+
+    CourseAccessProfile profile;
+    for (const string* key : makeTrace(1)) {
+        profile.Record(*catalog.lookupTable.Find(*key));
+    }
+    HotCourseIndex hotIndex;
+    hotIndex.Build(catalog, profile);
+    vector<const string*> trace = makeTrace(2);
+
+    cout << "Layout benchmark: " << keyCount << " courses, " << queryCount
+        << " Zipfian lookups (exponent " << exponent << ")" << endl;
+
+    CacheMissCounter counter;
+    auto measure = [&](const char* label, const auto& find) {
+        size_t found = 0;
+        auto started = chrono::steady_clock::now();
+        counter.Start();
+        for (const string* key : trace) {
+            if (find(*key) != nullptr) found++;
+        }
+        uint64_t misses = counter.Stop();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+        cout << "  " << label << ": " << seconds * 1e9 / queryCount << " ns/lookup, ";
+        if (counter.Available()) {
+            cout << static_cast<double>(misses) / queryCount << " cache misses/lookup";
+        }
+        else {
+            cout << "cache misses unavailable";
+        }
+        cout << " (" << found << " found)" << endl;
+    };
+
+    measure("ordered, insertion layout  ", [&](const string& key) { return catalog.Ordered().Find(key); });
+    measure("ordered, frequency layout  ", [&](const string& key) { return hotIndex.FindOrdered(key); });
+    measure("hashed, insertion layout   ", [&](const string& key) { return catalog.lookupTable.Find(key); });
+    measure("hashed, frequency layout   ", [&](const string& key) { return hotIndex.LookupTable().Find(key); });
+}
+
+/*
+Benchmarks lookups over a large catalog whose storage is on normal
+pages, transparent huge pages and explicit huge pages in turn.
+Courses are inserted in random order and looked up uniformly at random,
+so nearly every probe lands on a different 4KB page: the pattern where
+TLB reach rather than cache size bounds lookup latency. Each catalog is
+built under its mode and destroyed before the next one is built.
+*/
+void RunHugePageBenchmark(size_t keyCount) {
+    const size_t queryCount = 1 << 21;
+    const HugePageMode modes[] = { HugePageMode::Off, HugePageMode::Transparent, HugePageMode::Explicit };
+    const char* labels[] = { "normal pages     ", "transparent huge ", "explicit huge    " };
+    HugePageMode previousMode = hugepages::DefaultMode();
+
+    vector<string> keys(keyCount);
+    for (size_t i = 0; i < keyCount; ++i) {
+        keys[i] = "CS" + to_string(10000000 + i);
+    }
+    mt19937_64 generator(42);
+    vector<size_t> insertion(keyCount);
+    for (size_t i = 0; i < keyCount; ++i) insertion[i] = i;
+    shuffle(insertion.begin(), insertion.end(), generator);
+    vector<const string*> trace(queryCount);
+    for (auto& query : trace) query = &keys[generator() % keyCount];
+
+    cout << "Huge page benchmark: " << keyCount << " courses, " << queryCount
+        << " uniform lookups" << endl;
+    if (!hugepages::Supported()) {
+        cout << "  huge pages are not supported on this platform" << endl;
+        return;
+    }
+
+    for (size_t m = 0; m < 3; ++m) {
+        hugepages::DefaultMode() = modes[m];
+        size_t fallbacksBefore = hugepages::GetStats().fallbacks;
+        CourseCatalog catalog;
+        for (size_t i : insertion) {
+            catalog.courseMap.emplace(keys[i], Course{ keys[i], "Benchmark", {} });
+        }
+        RebuildIndexes(catalog);
+        catalog.Ordered();
+
+        cout << "  " << labels[m] << "(" << hugepages::ResidentHugeBytes() / (1 << 20)
+            << " MB of the process on huge pages";
+        if (hugepages::GetStats().fallbacks > fallbacksBefore) cout << ", with fallbacks";
+        cout << ")" << endl;
+
+        auto measure = [&](const char* label, const auto& find) {
+            size_t found = 0;
+            auto started = chrono::steady_clock::now();
+            for (const string* key : trace) {
+                if (find(*key)) found++;
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+            cout << "    " << label << ": " << seconds * 1e9 / queryCount << " ns/lookup ("
+                << found << " found)" << endl;
+        };
+        measure("hash map   ", [&](const string& key) { return catalog.courseMap.count(key) != 0; });
+        measure("flat table ", [&](const string& key) { return catalog.lookupTable.Find(key) != nullptr; });
+        measure("sorted tree", [&](const string& key) { return catalog.Ordered().Find(key) != nullptr; });
+    }
+    hugepages::DefaultMode() = previousMode;
+}
+
+/*
+Benchmarks parallel lookups from every scheduler worker, first against
+the catalog's single table and then against per-node replicas.
+Each task looks up a run of random course numbers through the table of
+the node it is running on. On a multi-socket machine the shared table
+is local to one socket only; on a single node both runs read local
+memory and the difference is just the routing overhead.
+*/
+void RunNumaBenchmark(size_t keyCount, NumaPlacement placement, TaskScheduler& scheduler) {
+    const size_t queryCount = 1 << 23;
+    const size_t grain = 1 << 12;
+
+    CourseCatalog catalog;
+    for (size_t i = 0; i < keyCount; ++i) {
+        string key = "CS" + to_string(10000000 + i);
+        catalog.courseMap.emplace(key, Course{ key, "Benchmark", {} });
+    }
+    RebuildIndexes(catalog);
+
+    NumaCatalogReplicas replicas;
+    replicas.Configure(placement);
+    replicas.Build(catalog);
+
+    mt19937_64 generator(42);
+    vector<string> trace(queryCount);
+    for (auto& key : trace) key = "CS" + to_string(10000000 + generator() % keyCount);
+
+    const numa::Topology& topology = replicas.GetTopology();
+    cout << "NUMA benchmark: " << keyCount << " courses, " << queryCount << " lookups on "
+        << scheduler.WorkerCount() << " workers, " << topology.NodeCount() << " node(s), "
+        << (placement == NumaPlacement::Interleave ? "interleaved" : "first-touch") << " replicas"
+        << endl;
+
+    for (int replicated = 0; replicated < 2; ++replicated) {
+        atomic<size_t> found(0);
+        auto started = chrono::steady_clock::now();
+        scheduler.ParallelFor(0, queryCount, grain, [&](size_t begin, size_t end) {
+            const CourseLookupTable& table = replicated
+                ? replicas.LocalLookupTable() : catalog.lookupTable;
+            size_t local = 0;
+            for (size_t i = begin; i < end; ++i) {
+                if (table.Find(trace[i]) != nullptr) local++;
+            }
+            found += local;
+        });
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        cout << "  " << (replicated ? "per-node replicas" : "shared table     ") << ": "
+            << queryCount / seconds / 1e6 << " Mlookups/s (" << found << " found)" << endl;
+    }
+}
+
+/*
+Data shared by every GenericIndex configuration in the index benchmark.
+Course numbers use even serials so the odd ones in between are known
+to be absent; updates insert and then erase a few of those.
+*/
+struct IndexBenchmarkData {
+    vector<string> keys;      // sorted and distinct
+    vector<Course> records;   // records[i] has course number keys[i]
+    vector<size_t> hits;      // random positions in keys to look up
+    vector<string> misses;    // absent course numbers to look up
+    vector<string> updates;   // absent course numbers to insert and erase
+};
+
+// Value stored for a record: the record itself, or a pointer to it
+template <typename Value>
+Value MakeIndexValue(const Course& record);
+
+template <>
+Course MakeIndexValue<Course>(const Course& record) { return record; }
+
+template <>
+const Course* MakeIndexValue<const Course*>(const Course& record) { return &record; }
+
+/*
+Runs one index configuration over the benchmark data and prints one row:
+bulk build, random hits, random misses, a full scan and single-entry
+updates, each per operation, followed by a consistency check.
+*/
+template <typename Index>
+void BenchmarkIndex(const char* label, const IndexBenchmarkData& data) {
+    using Value = typename Index::value_type;
+    auto timed = [](const auto& body) {
+        auto started = chrono::steady_clock::now();
+        body();
+        return chrono::duration<double>(chrono::steady_clock::now() - started).count() * 1e9;
+    };
+
+    Index index;
+    vector<pair<string, Value>> sorted;
+    sorted.reserve(data.keys.size());
+    for (size_t i = 0; i < data.keys.size(); ++i) {
+        sorted.emplace_back(data.keys[i], MakeIndexValue<Value>(data.records[i]));
+    }
+    double build = timed([&]() { index.Assign(move(sorted)); });
+
+    size_t hitsFound = 0;
+    double hit = timed([&]() {
+        for (size_t position : data.hits) {
+            if (index.Find(data.keys[position]) != nullptr) hitsFound++;
+        }
+    });
+
+    size_t missesFound = 0;
+    double miss = timed([&]() {
+        for (const string& key : data.misses) {
+            if (index.Find(key) != nullptr) missesFound++;
+        }
+    });
+
+    size_t visited = 0;
+    bool inOrder = true;
+    const string* previous = nullptr;
+    double scan = timed([&]() {
+        index.ForEach([&](const string& key, const Value&) {
+            if (previous != nullptr && !typename Index::key_compare()(*previous, key)) inOrder = false;
+            previous = &key;
+            visited++;
+        });
+    });
+
+    size_t changed = 0;
+    double update = timed([&]() {
+        for (const string& key : data.updates) {
+            if (index.Insert(key, MakeIndexValue<Value>(data.records[0]))) changed++;
+        }
+        for (const string& key : data.updates) {
+            if (index.Erase(key)) changed++;
+        }
+    });
+
+    bool consistent = hitsFound == data.hits.size() && missesFound == 0
+        && visited == data.keys.size() && (inOrder || !Index::kOrdered)
+        && changed == data.updates.size() * 2 && index.Size() == data.keys.size();
+    cout << "  " << left << setw(26) << label << right << fixed << setprecision(1)
+        << setw(10) << build / data.keys.size()
+        << setw(10) << hit / data.hits.size()
+        << setw(10) << miss / data.misses.size()
+        << setw(10) << scan / data.keys.size()
+        << setw(12) << update / (data.updates.size() * 2)
+        << "  " << (consistent ? "ok" : "MISMATCH") << defaultfloat << setprecision(6) << endl;
+}
+
+/*
+Instantiates every storage policy with records stored by value and by
+pointer, and runs each one on the same courses and query trace.
+Timings are nanoseconds per entry (build, scan) or per operation.
+*/
+void RunIndexBenchmark(size_t keyCount) {
+    const size_t queryCount = 1 << 20;
+    const size_t updateCount = max<size_t>(keyCount / 1024, 16);
+
+    IndexBenchmarkData data;
+    data.keys.reserve(keyCount);
+    data.records.reserve(keyCount);
+    for (size_t i = 0; i < keyCount; ++i) {
+        data.keys.push_back("CS" + to_string(10000000 + 2 * i));
+        data.records.push_back(Course{ data.keys.back(), "Benchmark course", {} });
+    }
+    mt19937_64 generator(42);
+    data.hits.resize(queryCount);
+    for (auto& position : data.hits) position = generator() % keyCount;
+    data.misses.resize(queryCount);
+    for (auto& key : data.misses) key = "CS" + to_string(10000001 + 2 * (generator() % keyCount));
+
+    vector<size_t> gaps(keyCount);
+    for (size_t i = 0; i < keyCount; ++i) gaps[i] = i;
+    shuffle(gaps.begin(), gaps.end(), generator);
+    for (size_t i = 0; i < min(updateCount, keyCount); ++i) {
+        data.updates.push_back("CS" + to_string(10000001 + 2 * gaps[i]));
+    }
+
+    cout << "Index benchmark: " << keyCount << " courses, " << queryCount
+        << " hits and misses, " << data.updates.size() << " inserts and erases (ns)" << endl;
+    cout << "  " << left << setw(26) << "storage, values" << right << setw(10) << "build"
+        << setw(10) << "hit" << setw(10) << "miss" << setw(10) << "scan" << setw(12) << "update"
+        << endl;
+
+    BenchmarkIndex<GenericIndex<string, Course, less<string>, PointerTreeStorage>>(
+        "pointer tree, records", data);
+    BenchmarkIndex<GenericIndex<string, const Course*, less<string>, PointerTreeStorage>>(
+        "pointer tree, pointers", data);
+    BenchmarkIndex<GenericIndex<string, Course, less<string>, FlatSortedStorage>>(
+        "flat sorted, records", data);
+    BenchmarkIndex<GenericIndex<string, const Course*, less<string>, FlatSortedStorage>>(
+        "flat sorted, pointers", data);
+    BenchmarkIndex<GenericIndex<string, Course, less<string>, BTreeStorage>>(
+        "B+ tree, records", data);
+    BenchmarkIndex<GenericIndex<string, const Course*, less<string>, BTreeStorage>>(
+        "B+ tree, pointers", data);
+    BenchmarkIndex<GenericIndex<string, Course, less<string>, HashStorage>>(
+        "hash, records", data);
+    BenchmarkIndex<GenericIndex<string, const Course*, less<string>, HashStorage>>(
+        "hash, pointers", data);
+
+    // Natural course-number order and the word-at-a-time hash it names
+    BenchmarkIndex<GenericIndex<string, Course, CourseNumberLess, PointerTreeStorage>>(
+        "pointer tree, natural", data);
+    BenchmarkIndex<GenericIndex<string, Course, CourseNumberLess, FlatSortedStorage>>(
+        "flat sorted, natural", data);
+    BenchmarkIndex<GenericIndex<string, Course, CourseNumberLess, BTreeStorage>>(
+        "B+ tree, natural", data);
+    BenchmarkIndex<GenericIndex<string, Course, CourseNumberLess, HashStorage>>(
+        "hash, course hash", data);
+}
+
+/*
+Splits a CSV line on every comma with stringstream, as the loader did
+before quoted fields were supported. Kept as the baseline of the CSV
+benchmark; it is wrong for any quoted field that contains a comma.
+*/
+Course ParseCourseLineNaive(const string& line) {
+    stringstream ss(line);
+    Course course;
+    string token;
+    getline(ss, course.courseNumber, ',');
+    getline(ss, course.courseTitle, ',');
+    CanonicalizeCourseKey(course.courseNumber);
+    while (getline(ss, token, ',')) {
+        CanonicalizeCourseKey(token);
+        if (!token.empty()) course.prerequisites.push_back(token);
+    }
+    return course;
+}
+
+/*
+Measures CSV parsing throughput on generated catalog lines.
+Plain lines are parsed by the naive comma split and by the RFC 4180
+parser, which must agree on them; a second set where every fourth
+title is quoted and contains commas and escaped quotes is parsed by the
+RFC 4180 parser only. UTF-8 validation, which every loaded row goes
+through first, is timed on the plain lines. Everything runs on one
+thread, so the numbers are per core.
+*/
+void RunCsvBenchmark(size_t lineCount) {
+    mt19937_64 generator(42);
+    vector<string> plain(lineCount);
+    vector<string> quoted(lineCount);
+    size_t plainBytes = 0;
+    size_t quotedBytes = 0;
+    for (size_t i = 0; i < lineCount; ++i) {
+        string number = "CS" + to_string(10000000 + i);
+        string prerequisites;
+        for (size_t p = generator() % 4; p > 0; --p) {
+            prerequisites += ",CS" + to_string(10000000 + generator() % lineCount);
+        }
+        plain[i] = number + ",Introduction to Topic " + to_string(i) + prerequisites;
+        quoted[i] = i % 4 == 0
+            ? number + ",\"Ethics, Law, and \"\"Topic\"\" " + to_string(i) + "\"" + prerequisites
+            : plain[i];
+        plainBytes += plain[i].size() + 1;
+        quotedBytes += quoted[i].size() + 1;
+    }
+
+    cout << "CSV benchmark: " << lineCount << " lines, one thread" << endl;
+    auto measure = [&](const char* label, const vector<string>& lines, size_t bytes,
+        Course (*parse)(const string&), vector<Course>& out) {
+        out.assign(lines.size(), Course());
+        auto started = chrono::steady_clock::now();
+        for (size_t i = 0; i < lines.size(); ++i) out[i] = parse(lines[i]);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        cout << "  " << label << ": " << bytes / seconds / 1e6 << " MB/s, "
+            << seconds * 1e9 / lines.size() << " ns/line" << endl;
+    };
+
+    vector<Course> naive;
+    vector<Course> rfc;
+    measure("naive split, plain   ", plain, plainBytes, ParseCourseLineNaive, naive);
+    measure("RFC 4180, plain      ", plain, plainBytes, ParseCourseLine, rfc);
+    bool agree = naive.size() == rfc.size();
+    for (size_t i = 0; agree && i < naive.size(); ++i) agree = naive[i] == rfc[i];
+    cout << "  parsers agree on plain lines: " << (agree ? "yes" : "NO") << endl;
+    vector<Course> quotedRfc;
+    measure("RFC 4180, quoted     ", quoted, quotedBytes, ParseCourseLine, quotedRfc);
+
+    size_t invalid = 0;
+    auto started = chrono::steady_clock::now();
+    for (const string& line : plain) {
+        if (FindInvalidUtf8(line) != string_view::npos) invalid++;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    cout << "  UTF-8 check, plain   : " << plainBytes / seconds / 1e9 << " GB/s ("
+        << invalid << " invalid lines)" << endl;
+}
+
+#ifndef _WIN32
+/*
+Key range served by one shard: first <= course number < last.
+An empty bound leaves that end of the range open.
+*/
+struct ShardRange {
+    string first;
+    string last;
+
+    bool Contains(const string& courseNumber) const {
+        return (first.empty() || CompareCourseNumbers(courseNumber, first) >= 0)
+            && (last.empty() || CompareCourseNumbers(courseNumber, last) < 0);
+    }
+};
+
+/*
+Loads only the courses of one key range from a CSV file.
+Prerequisites may live on other shards, so the missing-prerequisite
+check of LoadCourses is not repeated here.
+*/
+bool LoadShard(
+    const string& filename,
+    const ShardRange& range,
+    CourseCatalog& catalog,
+    TaskScheduler& scheduler
+) {
+    vector<Course> parsed;
+    if (!ReadCourseFile(filename, parsed, scheduler)) return false;
+
+    for (Course& course : parsed) {
+        if (range.Contains(course.courseNumber)) {
+            catalog.courseMap[course.courseNumber] = move(course);
+        }
+    }
+    RebuildIndexes(catalog);
+    cout << "Shard [" << (range.first.empty() ? "-" : range.first) << ", "
+        << (range.last.empty() ? "-" : range.last) << "): "
+        << catalog.courseMap.size() << " courses" << endl;
+    return true;
+}
+
+/*
+Shard protocol: one request per line, answered with a course count
+(u32) followed by that many records in the journal record format, so
+replies are framed and checksummed exactly like the write-ahead log.
+    FIND <course number>   zero or one course
+    LIST <from> <to>       courses with from <= number < to, in order;
+                           "-" leaves that end of the range open
+Unknown requests are answered with zero courses.
+*/
+string EncodeShardReply(const vector<const Course*>& courses) {
+    string reply;
+    journal::PutU32(reply, static_cast<uint32_t>(courses.size()));
+    for (const Course* course : courses) {
+        journal::EncodeRecord(reply, JournalRecord{ JournalOp::Upsert, *course });
+    }
+    return reply;
+}
+
+// Answers the requests of one router connection until it disconnects
+void ServeShardConnection(int fd, const CourseCatalog& catalog) {
+    net::Connection connection(fd);
+    string line;
+    while (connection.ReadLine(line)) {
+        istringstream request(line);
+        string command;
+        string first;
+        string last;
+        request >> command >> first >> last;
+
+        vector<const Course*> courses;
+        if (command == "FIND") {
+            const Course* course = catalog.lookupTable.Find(first);
+            if (course != nullptr) courses.push_back(course);
+        }
+        else if (command == "LIST") {
+            const CourseBST& bst = catalog.Ordered();
+            size_t begin = (first == "-") ? 0 : bst.Rank(first);
+            size_t end = (last == "-") ? bst.Size() : bst.Rank(last);
+            if (end > begin) bst.CollectRange(begin, end - begin, courses);
+        }
+        if (!connection.WriteAll(EncodeShardReply(courses))) return;
+    }
+}
+
+/*
+Serves a loaded shard until the process is stopped or the listener
+fails. The catalog is read-only while serving, so every connection gets
+its own thread and no locking is needed. At most kMaxShardConnections
+are served at once; further connections are closed straight away, and
+a router that stops reading its replies is cut off after a send timeout.
+*/
+bool ServeShard(const string& address, const CourseCatalog& catalog) {
+    const size_t kMaxShardConnections = 256;
+    const int kShardSendTimeoutMs = 5000;
+    static atomic<size_t> activeConnections(0);
+
+    signal(SIGPIPE, SIG_IGN);   // a vanished router must not end the shard
+    int listener = net::OpenSocket(address, true);
+    if (listener < 0) {
+        cout << "Error: Unable to listen on " << address << endl;
+        return false;
+    }
+    cout << "Serving " << catalog.courseMap.size() << " courses on " << address << endl;
+
+    while (true) {
+        bool closed;
+        int fd = net::Accept(listener, closed);
+        if (closed) {
+            cout << "Error: Stopped accepting connections on " << address << endl;
+            close(listener);
+            return false;
+        }
+        if (fd < 0) continue;
+        if (activeConnections >= kMaxShardConnections
+            || !net::SetTimeouts(fd, 0, kShardSendTimeoutMs)) {
+            close(fd);
+            continue;
+        }
+        activeConnections++;
+        thread([fd, &catalog]() {
+            ServeShardConnection(fd, catalog);
+            activeConnections--;
+        }).detach();
+    }
+}
+
+/*
+Routes queries across key-range shards.
+Shard i serves course numbers from its first key up to the first key of
+shard i + 1, so a lookup goes to exactly one shard (binary search over
+the boundaries) and a range list only to the shards it overlaps.
+Overlapping shards are queried at the same time on plain threads,
+since each one only waits on a socket, and the sorted replies are
+merged. A shard that does not answer within kReplyTimeoutMs fails the
+request, and a failed connection is reopened on the next request.
+*/
+class ShardRouter {
+private:
+    struct Shard {
+        string address;
+        string first;
+        unique_ptr<net::Connection> connection;
+    };
+
+    vector<Shard> shards;   // sorted by first key
+
+    static const int kReplyTimeoutMs = 5000;
+
+    // Connects to a shard with send and receive timeouts; null on failure
+    static unique_ptr<net::Connection> openConnection(const string& address) {
+        int fd = net::OpenSocket(address, false);
+        if (fd < 0) return nullptr;
+        auto connection = make_unique<net::Connection>(fd);
+        if (!net::SetTimeouts(fd, kReplyTimeoutMs, kReplyTimeoutMs)) return nullptr;
+        return connection;
+    }
+
+    /*
+    Sends one request line and decodes the courses in the reply.
+    Only a reused connection is retried, since the shard may have closed
+    it while idle; a fresh connection that fails means the shard is down
+    or hung, and waiting on it again would double the delay.
+    */
+    static bool request(Shard& shard, const string& line, vector<Course>& courses) {
+        while (true) {
+            bool reused = static_cast<bool>(shard.connection);
+            if (!reused) {
+                shard.connection = openConnection(shard.address);
+                if (!shard.connection) return false;
+            }
+
+            vector<JournalRecord> records;
+            if (shard.connection->WriteAll(line + "\n")
+                && ReadRecordBatch(*shard.connection, records)) {
+                courses.clear();
+                courses.reserve(records.size());
+                for (auto& record : records) courses.push_back(move(record.course));
+                return true;
+            }
+            shard.connection.reset();
+            if (!reused) return false;
+        }
+    }
+
+    // Index of the shard whose range holds the course number
+    size_t shardFor(const string& courseNumber) const {
+        size_t index = 0;
+        for (size_t step = shards.size(); step > 0; step /= 2) {
+            while (index + step < shards.size() && CompareCourseNumbers(shards[index + step].first, courseNumber) <= 0) {
+                index += step;
+            }
+        }
+        return index;
+    }
+
+public:
+    /*
+    Adds a shard. Shards may be added in any order; the shard with the
+    smallest first key also serves every course number below it.
+    */
+    void AddShard(const string& address, const string& first) {
+        Shard shard;
+        shard.address = address;
+        shard.first = first;
+        auto position = upper_bound(shards.begin(), shards.end(), first,
+            [](const string& key, const Shard& other) { return CompareCourseNumbers(key, other.first) < 0; });
+        shards.insert(position, move(shard));
+    }
+
+    size_t ShardCount() const { return shards.size(); }
+
+    /*
+    Opens a connection to every shard, retrying for up to timeoutMs so
+    shards that are still loading have time to start listening.
+    */
+    bool Connect(int timeoutMs) {
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+        for (Shard& shard : shards) {
+            while (!shard.connection) {
+                shard.connection = openConnection(shard.address);
+                if (shard.connection) break;
+                if (chrono::steady_clock::now() >= deadline) {
+                    cout << "Error: Unable to reach shard " << shard.address << endl;
+                    return false;
+                }
+                this_thread::sleep_for(chrono::milliseconds(20));
+            }
+        }
+        return true;
+    }
+
+    // Looks a course up on its shard; false when it is absent or unreachable
+    bool Find(const string& courseNumber, Course& course) {
+        if (shards.empty()) return false;
+        vector<Course> courses;
+        if (!request(shards[shardFor(courseNumber)], "FIND " + courseNumber, courses)
+            || courses.empty()) {
+            return false;
+        }
+        course = move(courses.front());
+        return true;
+    }
+
+    /*
+    Lists courses with from <= number < to in sorted order; an empty
+    bound is open. Returns false when an overlapping shard is unreachable.
+    */
+    bool List(const string& from, const string& to, vector<Course>& courses) {
+        courses.clear();
+        if (shards.empty() || (!from.empty() && !to.empty() && CompareCourseNumbers(to, from) <= 0)) return true;
+        size_t firstShard = from.empty() ? 0 : shardFor(from);
+        size_t lastShard = to.empty() ? shards.size() - 1 : shardFor(to);
+        if (!to.empty() && lastShard > firstShard && shards[lastShard].first == to) lastShard--;
+
+        string line = "LIST " + (from.empty() ? string("-") : from) + " "
+            + (to.empty() ? string("-") : to);
+        size_t count = lastShard - firstShard + 1;
+        vector<vector<Course>> replies(count);
+        vector<char> succeeded(count, 0);
+        vector<thread> threads;
+        for (size_t i = 0; i < count; ++i) {
+            threads.emplace_back([&, i]() {
+                succeeded[i] = request(shards[firstShard + i], line, replies[i]);
+            });
+        }
+        for (auto& worker : threads) worker.join();
+        for (char ok : succeeded) {
+            if (!ok) return false;
+        }
+
+        // K-way merge keeps the result sorted even if shard ranges overlap
+        using Cursor = pair<size_t, size_t>;   // reply, position
+        auto later = [&](const Cursor& a, const Cursor& b) {
+            return CompareCourseNumbers(replies[a.first][a.second].courseNumber,
+                replies[b.first][b.second].courseNumber) > 0;
+        };
+        priority_queue<Cursor, vector<Cursor>, decltype(later)> heads(later);
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            total += replies[i].size();
+            if (!replies[i].empty()) heads.push(Cursor{ i, 0 });
+        }
+        courses.reserve(total);
+        while (!heads.empty()) {
+            Cursor cursor = heads.top();
+            heads.pop();
+            courses.push_back(move(replies[cursor.first][cursor.second]));
+            if (++cursor.second < replies[cursor.first].size()) heads.push(cursor);
+        }
+        return true;
+    }
+};
+
+/*
+Reads router commands from standard input until "quit":
+    find <course number>
+    list [from [to]]
+*/
+void RunShardRouter(ShardRouter& router) {
+    signal(SIGPIPE, SIG_IGN);
+    cout << "Router ready for " << router.ShardCount()
+        << " shards. Commands: find <course>, list [from [to]], quit" << endl;
+
+    string line;
+    while (cout << "> " << flush, getline(cin, line)) {
+        istringstream input(line);
+        string command;
+        string first;
+        string last;
+        input >> command >> first >> last;
+        UppercaseAscii(&command[0], command.size());
+        CanonicalizeCourseKey(first);
+        CanonicalizeCourseKey(last);
+
+        auto started = chrono::steady_clock::now();
+        if (command == "QUIT" || command == "EXIT") {
+            return;
+        }
+        else if (command == "FIND" && !first.empty()) {
+            Course course;
+            if (router.Find(first, course)) PrintCourseDetails(course);
+            else cout << "Course not found." << endl;
+        }
+        else if (command == "LIST") {
+            vector<Course> courses;
+            if (!router.List(first, last, courses)) {
+                cout << "Error: A shard did not answer." << endl;
+                continue;
+            }
+            for (const Course& course : courses) {
+                cout << course.courseNumber << ", " << course.courseTitle << endl;
+            }
+            cout << courses.size() << " courses";
+        }
+        else {
+            if (!command.empty()) cout << "Unknown command." << endl;
+            continue;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        if (command == "LIST") cout << " in " << seconds * 1000.0 << " ms" << endl;
+    }
+}
+
+/*
+Parses a router shard list: address@firstKey entries separated by
+commas. The entry without a first key (or with the smallest one)
+serves everything below the next boundary.
+*/
+bool ParseShardList(const string& list, ShardRouter& router) {
+    stringstream entries(list);
+    string entry;
+    while (getline(entries, entry, ',')) {
+        size_t at = entry.rfind('@');
+        string address = entry.substr(0, at);
+        string first = (at == string::npos) ? string() : entry.substr(at + 1);
+        CanonicalizeCourseKey(first);
+        if (address.empty()) {
+            cout << "Error: Empty shard address in " << list << endl;
+            return false;
+        }
+        router.AddShard(address, first);
+    }
+    return router.ShardCount() > 0;
+}
+
+/*
+Runs a complete sharded setup on one machine for testing.
+The file is loaded once to pick boundaries that give every shard about
+the same number of courses, then one child process per shard loads its
+range and serves it on a Unix socket while this process acts as the
+router. The loading scheduler is destroyed before forking so the
+children start without inherited worker threads.
+*/
+void RunShardDemo(unsigned shardCount, const string& filename) {
+    vector<string> boundaries;
+    {
+        TaskScheduler scheduler;
+        CourseCatalog catalog;
+        if (!LoadCourses(filename, catalog, scheduler)) return;
+        const CourseBST& bst = catalog.Ordered();
+        size_t total = bst.Size();
+        for (unsigned i = 1; i < shardCount; ++i) {
+            const Course* course = bst.Select(total * i / shardCount);
+            if (course != nullptr && (boundaries.empty()
+                || CompareCourseNumbers(course->courseNumber, boundaries.back()) > 0)) {
+                boundaries.push_back(course->courseNumber);
+            }
+        }
+    }
+
+    ShardRouter router;
+    vector<pid_t> children;
+    vector<string> paths;
+    for (size_t i = 0; i <= boundaries.size(); ++i) {
+        ShardRange range{ i == 0 ? string() : boundaries[i - 1],
+            i == boundaries.size() ? string() : boundaries[i] };
+        string path = "/tmp/course-shard-" + to_string(getpid()) + "-" + to_string(i) + ".sock";
+        string address = "unix:" + path;
+
+        cout.flush();
+        pid_t child = fork();
+        if (child == 0) {
+            TaskScheduler scheduler;
+            CourseCatalog catalog;
+            if (LoadShard(filename, range, catalog, scheduler)) ServeShard(address, catalog);
+            cout.flush();
+            _exit(1);
+        }
+        if (child < 0) {
+            cout << "Error: Unable to start shard " << i << endl;
+            break;
+        }
+        children.push_back(child);
+        paths.push_back(path);
+        router.AddShard(address, range.first);
+    }
+
+    if (children.size() == boundaries.size() + 1 && router.Connect(10000)) {
+        RunShardRouter(router);
+    }
+
+    for (pid_t child : children) kill(child, SIGTERM);
+    for (pid_t child : children) waitpid(child, nullptr, 0);
+    for (const string& path : paths) unlink(path.c_str());
+}
+
+/*
+Read-only replica kept in sync with a publishing primary.
+A background thread connects, loads the snapshot batch in one bulk
+rebuild, then applies every later batch incrementally under an
+exclusive lock, so queries (shared lock) always see whole batches.
+When the primary goes away the replica keeps serving its last state
+and reconnects, starting again from a fresh snapshot.
+*/
+class CatalogFollower {
+private:
+    CourseCatalog catalog;
+    mutable shared_mutex lock;
+    string address;
+    thread applier;
+    atomic<bool> stopping;
+    atomic<int> activeSocket;
+    atomic<uint64_t> appliedBatches;
+
+    void applyLoop() {
+        bool announced = false;
+        while (!stopping) {
+            int fd = net::OpenSocket(address, false);
+            if (fd < 0) {
+                this_thread::sleep_for(chrono::milliseconds(200));
+                continue;
+            }
+            activeSocket = fd;
+            net::Connection connection(fd);
+
+            vector<JournalRecord> records;
+            if (ReadRecordBatch(connection, records)) {
+                unique_lock<shared_mutex> guard(lock);
+                catalog.courseMap.clear();
+                for (auto& record : records) {
+                    catalog.courseMap[record.course.courseNumber] = move(record.course);
+                }
+                RebuildIndexes(catalog);
+                appliedBatches++;
+                if (!announced) {
+                    cout << "Follower: bootstrapped " << catalog.courseMap.size()
+                        << " courses from " << address << endl;
+                    announced = true;
+                }
+            }
+
+            while (!stopping && ReadRecordBatch(connection, records)) {
+                unique_lock<shared_mutex> guard(lock);
+                for (const auto& record : records) {
+                    if (record.op == JournalOp::Upsert) {
+                        UpsertCourse(catalog, record.course);
+                    }
+                    else {
+                        RemoveCourse(catalog, record.course.courseNumber);
+                    }
+                }
+                catalog.lookupTable.RefreshFilter();
+                appliedBatches++;
+            }
+            activeSocket = -1;
+        }
+    }
+
+public:
+    explicit CatalogFollower(const string& primaryAddress)
+        : address(primaryAddress), stopping(false), activeSocket(-1), appliedBatches(0) {
+        applier = thread(&CatalogFollower::applyLoop, this);
+    }
+
+    ~CatalogFollower() {
+        stopping = true;
+        int fd = activeSocket;
+        if (fd >= 0) shutdown(fd, SHUT_RDWR);   // wakes the blocked read
+        applier.join();
+    }
+
+    CatalogFollower(const CatalogFollower&) = delete;
+    CatalogFollower& operator=(const CatalogFollower&) = delete;
+
+    uint64_t AppliedBatches() const { return appliedBatches; }
+
+    // Runs reader(catalog) while no batch is being applied
+    template <typename Reader>
+    void Read(const Reader& reader) const {
+        shared_lock<shared_mutex> guard(lock);
+        reader(catalog);
+    }
+};
+
+/*
+Answers queries from a follower until "quit":
+    find <course number>
+    list [from [to]]
+    status
+*/
+void RunFollower(const string& address) {
+    signal(SIGPIPE, SIG_IGN);
+    CatalogFollower follower(address);
+    cout << "Following " << address
+        << ". Commands: find <course>, list [from [to]], status, quit" << endl;
+
+    string line;
+    while (cout << "> " << flush, getline(cin, line)) {
+        istringstream input(line);
+        string command;
+        string first;
+        string last;
+        input >> command >> first >> last;
+        UppercaseAscii(&command[0], command.size());
+        CanonicalizeCourseKey(first);
+        CanonicalizeCourseKey(last);
+
+        if (command == "QUIT" || command == "EXIT") {
+            return;
+        }
+        else if (command == "FIND" && !first.empty()) {
+            follower.Read([&](const CourseCatalog& catalog) {
+                const Course* course = catalog.lookupTable.Find(first);
+                if (course != nullptr) PrintCourseDetails(*course);
+                else cout << "Course not found." << endl;
+            });
+        }
+        else if (command == "LIST") {
+            follower.Read([&](const CourseCatalog& catalog) {
+                const CourseBST& bst = catalog.Ordered();
+                size_t begin = first.empty() ? 0 : bst.Rank(first);
+                size_t end = last.empty() ? bst.Size() : bst.Rank(last);
+                if (end > begin) bst.PrintRange(begin, end - begin);
+                cout << (end > begin ? end - begin : 0) << " courses" << endl;
+            });
+        }
+        else if (command == "STATUS") {
+            follower.Read([&](const CourseCatalog& catalog) {
+                cout << catalog.courseMap.size() << " courses, "
+                    << follower.AppliedBatches() << " batches applied" << endl;
+            });
+        }
+        else if (!command.empty()) {
+            cout << "Unknown command." << endl;
+        }
+    }
+}
+#endif
+
+/*
+Merges a background load into the catalog, waiting for it if needed.
+Followers receive only the courses the load added or changed, the
+catalog's slack is reclaimed, and an open journal is compacted so
+restarts replay the snapshot instead of the CSV. Does nothing when no
+load is pending.
 */
-int main() {
-    CourseBST bst;
-    unordered_map<string, Course> courseMap;
+void FinishBackgroundLoad(BackgroundLoad& load, CourseCatalog& catalog,
+    TaskScheduler& scheduler, ReplicationPublisher& publisher,
+    CatalogJournal& journal, TaskGroup& derivedBuild, bool backgroundIndex,
+    bool& dataLoaded) {
+    if (!load.Pending()) return;
+    vector<Course> parsed = load.TakeCourses();
+    ReportMalformedRows(load.FileName(), load.Issues());
+    size_t released = 0;
+    {
+        auto guard = publisher.LockCatalog();
+        vector<string> changed;
+        MergeCourses(parsed, catalog, scheduler, &changed);
+        publisher.PublishCourses(catalog, move(changed));
+        released = CompactCatalog(catalog);
+    }
+    if (backgroundIndex) BuildDerivedInBackground(catalog, derivedBuild);
+    dataLoaded = true;
+    cout << "Course data loaded successfully (" << parsed.size() << " rows from "
+        << load.FileName() << ", " << released / 1024 << " KB of slack released)." << endl;
+
+    if (journal.IsOpen()) journal.Compact(catalog);
+}
+
+/*
+Main program loop.
+Includes input validation and logical flow checks
+to prevent user actions before data is loaded.
+Option 1 loads in the background: lookups and sorted pages are served
+from the rows read so far, other options wait for the load to finish,
+and option 15 reports its progress or cancels it.
+
+Command line options:
+--threads N   number of scheduler workers (default: one per hardware thread)
+--pin         pin each worker thread to its own core
+--journal P   keep catalog edits in the write-ahead log P.log with
+              snapshots in P.snap; the catalog is recovered at startup
+--bench-concurrent N
+              benchmark the concurrent index with N threads and exit
+--bench-layout
+              benchmark the access-frequency layout on a Zipfian trace and exit
+--bench-index N
+              run every GenericIndex storage policy on the same N courses
+              (0 for 262144) and exit
+--huge-pages off|thp|explicit
+              keep catalog nodes, flat tables and hash buckets in 2MB pages:
+              thp advises transparent huge pages, explicit uses reserved
+              pages and falls back to thp when none are reserved; give it
+              before any option that loads a catalog
+--bench-csv N
+              compare the naive comma split with the RFC 4180 parser on N
+              generated lines (0 for about a million) and exit
+--bench-huge-pages N
+              compare lookup latency on normal and huge pages with N
+              courses (0 for about a million) and exit
+--numa-replicas first-touch|interleave
+              on multi-socket machines serve lookups from a catalog copy
+              in each NUMA node's memory, or from one copy interleaved
+              over all nodes; ignored on single-node machines
+--bench-numa N
+              compare parallel lookups on a shared table and on NUMA
+              replicas with N courses (0 for about a million) and exit
+--serve-shard ADDRESS FILE FIRST LAST
+              serve the courses FIRST <= number < LAST of FILE on ADDRESS
+              (unix:/path or host:port); "-" leaves a bound open
+--route SHARDS
+              route find/list commands from standard input to the shards
+              in SHARDS, a list of address@firstKey entries
+--shard-demo N FILE
+              split FILE across N local shard processes and route to them
+--publish ADDRESS
+              stream catalog changes to followers connecting on ADDRESS
+--follow ADDRESS
+              run a read-only replica of the primary publishing on ADDRESS
+--background-index
+              build the sorted and reverse indexes right after each load
+              instead of on first use
+*/
+int main(int argc, char* argv[]) {
+    unsigned workerCount = 0;
+    bool pinWorkers = false;
+    string journalPath;
+    string publishAddress;
+    bool backgroundIndex = false;
+    NumaPlacement numaPlacement = NumaPlacement::Off;
+    for (int i = 1; i < argc; ++i) {
+        string option = argv[i];
+        if (option == "--threads" && i + 1 < argc) {
+            workerCount = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (option == "--pin") {
+            pinWorkers = true;
+        }
+        else if (option == "--journal" && i + 1 < argc) {
+            journalPath = argv[++i];
+        }
+        else if (option == "--bench-concurrent" && i + 1 < argc) {
+            unsigned threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+            RunConcurrentIndexBenchmark(threads == 0 ? 1 : threads);
+            return 0;
+        }
+        else if (option == "--bench-layout") {
+            RunLayoutBenchmark();
+            return 0;
+        }
+        else if (option == "--bench-index" && i + 1 < argc) {
+            size_t courses = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+            RunIndexBenchmark(courses == 0 ? size_t(1) << 18 : courses);
+            return 0;
+        }
+        else if (option == "--bench-csv" && i + 1 < argc) {
+            size_t lines = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+            RunCsvBenchmark(lines == 0 ? size_t(1) << 20 : lines);
+            return 0;
+        }
+        else if (option == "--bench-huge-pages" && i + 1 < argc) {
+            size_t courses = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+            RunHugePageBenchmark(courses == 0 ? size_t(1) << 20 : courses);
+            return 0;
+        }
+        else if (option == "--numa-replicas" && i + 1 < argc) {
+            string mode = argv[++i];
+            if (mode == "first-touch") numaPlacement = NumaPlacement::FirstTouch;
+            else if (mode == "interleave") numaPlacement = NumaPlacement::Interleave;
+            else if (mode == "off") numaPlacement = NumaPlacement::Off;
+            else cout << "Ignoring unknown NUMA placement " << mode << endl;
+        }
+        else if (option == "--bench-numa" && i + 1 < argc) {
+            size_t courses = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+            TaskScheduler scheduler(workerCount, pinWorkers);
+            RunNumaBenchmark(courses == 0 ? size_t(1) << 20 : courses,
+                numaPlacement == NumaPlacement::Off ? NumaPlacement::FirstTouch : numaPlacement,
+                scheduler);
+            return 0;
+        }
+        else if (option == "--huge-pages" && i + 1 < argc) {
+            string mode = argv[++i];
+            if (mode == "thp") hugepages::DefaultMode() = HugePageMode::Transparent;
+            else if (mode == "explicit") hugepages::DefaultMode() = HugePageMode::Explicit;
+            else if (mode == "off") hugepages::DefaultMode() = HugePageMode::Off;
+            else cout << "Ignoring unknown huge page mode " << mode << endl;
+        }
+#ifndef _WIN32
+        else if (option == "--serve-shard" && i + 4 < argc) {
+            string address = argv[i + 1];
+            string filename = argv[i + 2];
+            ShardRange range{ argv[i + 3], argv[i + 4] };
+            if (range.first == "-") range.first.clear();
+            if (range.last == "-") range.last.clear();
+            CanonicalizeCourseKey(range.first);
+            CanonicalizeCourseKey(range.last);
+
+            TaskScheduler scheduler(workerCount, pinWorkers);
+            CourseCatalog catalog;
+            if (!LoadShard(filename, range, catalog, scheduler)) return 1;
+            return ServeShard(address, catalog) ? 0 : 1;
+        }
+        else if (option == "--route" && i + 1 < argc) {
+            ShardRouter router;
+            if (!ParseShardList(argv[i + 1], router) || !router.Connect(10000)) return 1;
+            RunShardRouter(router);
+            return 0;
+        }
+        else if (option == "--shard-demo" && i + 2 < argc) {
+            unsigned shards = static_cast<unsigned>(strtoul(argv[i + 1], nullptr, 10));
+            RunShardDemo(shards == 0 ? 1 : shards, argv[i + 2]);
+            return 0;
+        }
+        else if (option == "--follow" && i + 1 < argc) {
+            RunFollower(argv[i + 1]);
+            return 0;
+        }
+#endif
+        else if (option == "--publish" && i + 1 < argc) {
+            publishAddress = argv[++i];
+        }
+        else if (option == "--background-index") {
+            backgroundIndex = true;
+        }
+        else {
+            cout << "Ignoring unknown option " << option << endl;
+        }
+    }
+
+    // One scheduler is shared by every parallel stage for the whole session
+    TaskScheduler scheduler(workerCount, pinWorkers);
+
+    CourseCatalog catalog;
+    CatalogJournal catalogJournal;
+    ReplicationPublisher publisher;
+    TermCatalog termCatalog;
+    CourseIdIndex courseIds;
+    StudentTranscripts transcripts;
+    PrerequisiteClosure closure;
+    CourseAccessProfile accessProfile;
+    HotCourseIndex hotIndex;
+    NumaCatalogReplicas numaReplicas;
+    TaskGroup derivedBuild(scheduler);   // declared after the catalog so it is joined first
+    BackgroundLoad backgroundLoad;
     bool dataLoaded = false;   // Prevents invalid operations
 
+    if (numaPlacement != NumaPlacement::Off) {
+        numaReplicas.Configure(numaPlacement);
+        size_t nodes = numaReplicas.GetTopology().NodeCount();
+        if (numaReplicas.Enabled()) {
+            cout << "NUMA: " << nodes << " nodes; lookups use a "
+                << (numaPlacement == NumaPlacement::Interleave ? "node-interleaved copy" : "replica per node")
+                << " of the catalog." << endl;
+        }
+        else {
+            cout << "NUMA: one node; lookups use the shared catalog." << endl;
+        }
+    }
+
+    // A journal with a snapshot or log records replaces the initial CSV load
+    if (!journalPath.empty()) {
+        dataLoaded = catalogJournal.Open(journalPath, catalog);
+        if (dataLoaded) CompactCatalog(catalog);
+        if (dataLoaded && backgroundIndex) BuildDerivedInBackground(catalog, derivedBuild);
+    }
+
+    // Followers bootstrap from whatever the catalog holds when they connect
+    if (!publishAddress.empty() && !publisher.Start(publishAddress, catalog)) return 1;
+
     int choice;
     string filename;
     string courseInput;
@@ -219,10 +7738,32 @@ int main() {
     cout << "Welcome to the course planner." << endl;
 
     while (true) {
+        // A finished background load is merged before the next command
+        if (backgroundLoad.Finished()) {
+            FinishBackgroundLoad(backgroundLoad, catalog, scheduler, publisher, catalogJournal,
+                derivedBuild, backgroundIndex, dataLoaded);
+        }
+        else if (backgroundLoad.Pending()) {
+            cout << endl;
+            backgroundLoad.PrintProgress();
+        }
+
         cout << "\n1. Load Data Structure" << endl;
         cout << "2. Print Course List" << endl;
         cout << "3. Print Course" << endl;
+        cout << "4. Print Several Courses" << endl;
+        cout << "5. Print Course List Page" << endl;
+        cout << "6. Export Course Data" << endl;
+        cout << "7. Load Term Catalog" << endl;
+        cout << "8. Print Course For Term" << endl;
         cout << "9. Exit" << endl;
+        cout << "10. Edit Course" << endl;
+        cout << "11. Load Student Transcripts" << endl;
+        cout << "12. Print Student Eligibility" << endl;
+        cout << "13. Recommend Next Courses" << endl;
+        cout << "14. Find Redundant Prerequisites" << endl;
+        cout << "15. Load Progress / Cancel Load" << endl;
+        cout << "16. Memory Report" << endl;
         cout << "\nWhat would you like to do? ";
 
         // Validate numeric input
@@ -235,14 +7776,24 @@ int main() {
 
         cin.ignore();
 
+        // These options need the whole catalog, so a background load is merged first
+        if (choice == 2 || choice == 4 || choice == 6 || (choice >= 10 && choice <= 14) || choice == 16) {
+            FinishBackgroundLoad(backgroundLoad, catalog, scheduler, publisher, catalogJournal,
+                derivedBuild, backgroundIndex, dataLoaded);
+        }
+
         switch (choice) {
         case 1:
+            if (backgroundLoad.Pending()) {
+                cout << "A load is already in progress; use option 15 to cancel it." << endl;
+                break;
+            }
             cout << "Enter file name (press Enter for default): ";
             getline(cin, filename);
             if (filename.empty()) filename = defaultFile;
-            LoadCourses(filename, bst, courseMap);
-            dataLoaded = true;
-            cout << "Course data loaded successfully." << endl;
+            if (backgroundLoad.Start(filename, scheduler)) {
+                cout << "Loading " << filename << " in the background." << endl;
+            }
             break;
 
         case 2:
@@ -251,19 +7802,301 @@ int main() {
                 break;
             }
             cout << "\nHere is a sample schedule:\n" << endl;
-            bst.PrintSortedCourses();
+            catalog.Ordered().PrintSortedCourses();
             break;
 
         case 3:
+            if (!dataLoaded && !backgroundLoad.Pending()) {
+                cout << "\nError: No course data loaded. Please load data first.\n";
+                break;
+            }
+            cout << "What course do you want to know about? ";
+            getline(cin, courseInput);
+            if (backgroundLoad.Pending()) {
+                // Rows already read from the file are newer than the catalog
+                Course course;
+                string courseNumber(TrimKeyWhitespace(courseInput));
+                CanonicalizeCourseKey(courseNumber);
+                if (backgroundLoad.WaitForCourse(courseNumber, course)) {
+                    accessProfile.Record(course);
+                    PrintCourseDetails(course);
+                    break;
+                }
+                if (backgroundLoad.Finished()) {
+                    FinishBackgroundLoad(backgroundLoad, catalog, scheduler, publisher,
+                        catalogJournal, derivedBuild, backgroundIndex, dataLoaded);
+                }
+                if (!dataLoaded) {
+                    cout << "Course not found." << endl;
+                    break;
+                }
+            }
+            PrintCourseDetails(courseInput, ActiveLookupTable(catalog, hotIndex, numaReplicas), accessProfile);
+            MaybeReorganize(catalog, accessProfile, hotIndex);
+            break;
+
+        case 4:
+            if (!dataLoaded) {
+                cout << "\nError: No course data loaded. Please load data first.\n";
+                break;
+            }
+            cout << "Which courses do you want to know about? ";
+            getline(cin, courseInput);
+            PrintCourseBatch(courseInput, ActiveLookupTable(catalog, hotIndex, numaReplicas), accessProfile);
+            MaybeReorganize(catalog, accessProfile, hotIndex);
+            break;
+
+        case 5:
+            if (!dataLoaded && !backgroundLoad.Pending()) {
+                cout << "\nError: No course data loaded. Please load data first.\n";
+                break;
+            }
+            cout << "Enter a page number or a course number: ";
+            getline(cin, courseInput);
+
+            // Into an empty catalog a sorted file's prefix is already the final list
+            if (!dataLoaded && backgroundLoad.PrintSortedPage(courseInput, kCoursesPerPage)) break;
+            FinishBackgroundLoad(backgroundLoad, catalog, scheduler, publisher, catalogJournal,
+                derivedBuild, backgroundIndex, dataLoaded);
+            catalog.lookupTable.RefreshFilter();
+            PrintCoursePage(courseInput, catalog.Ordered(), catalog.lookupTable);
+            break;
+
+        case 6:
             if (!dataLoaded) {
                 cout << "\nError: No course data loaded. Please load data first.\n";
                 break;
             }
+            cout << "Export format (json or csv): ";
+            getline(cin, courseInput);
+            UppercaseAscii(&courseInput[0], courseInput.size());
+            if (courseInput != "JSON" && courseInput != "CSV") {
+                cout << "Unknown export format." << endl;
+                break;
+            }
+            cout << "Enter output file name: ";
+            getline(cin, filename);
+            if (filename.empty()) {
+                cout << "No file name entered." << endl;
+                break;
+            }
+            ExportCatalog(filename,
+                courseInput == "JSON" ? ExportFormat::Json : ExportFormat::Csv,
+                catalog, scheduler);
+            break;
+
+        case 7: {
+            cout << "Enter the term (for example 2026FA): ";
+            string term;
+            getline(cin, term);
+            CanonicalizeCourseKey(term);
+            if (term.empty()) {
+                cout << "No term entered." << endl;
+                break;
+            }
+            cout << "Enter file name for " << term << ": ";
+            getline(cin, filename);
+            if (termCatalog.LoadTerm(term, filename, scheduler)) {
+                termCatalog.PrintSummary();
+            }
+            break;
+        }
+
+        case 8: {
+            cout << "Enter the term: ";
+            string term;
+            getline(cin, term);
+            CanonicalizeCourseKey(term);
+            if (!termCatalog.HasTerm(term)) {
+                cout << "Term " << term << " is not loaded." << endl;
+                break;
+            }
             cout << "What course do you want to know about? ";
             getline(cin, courseInput);
-            transform(courseInput.begin(), courseInput.end(),
-                courseInput.begin(), ::toupper);
-            PrintCourseDetails(courseInput, courseMap);
+            CanonicalizeCourseKey(courseInput);
+            const Course* course = termCatalog.FindCourse(term, courseInput);
+            if (course == nullptr) {
+                cout << "Course not found in " << term << "." << endl;
+            }
+            else {
+                PrintCourseDetails(*course);
+            }
+            break;
+        }
+
+        case 10: {
+            cout << "Enter A to add or update a course, or R to remove one: ";
+            getline(cin, courseInput);
+            CanonicalizeCourseKey(courseInput);
+
+            JournalRecord record;
+            if (courseInput == "A") {
+                cout << "Enter the course (number, title, prerequisites...): ";
+                getline(cin, courseInput);
+                record.op = JournalOp::Upsert;
+                record.course = ParseCourseLine(courseInput);
+            }
+            else if (courseInput == "R") {
+                cout << "Which course do you want to remove? ";
+                getline(cin, courseInput);
+                record.op = JournalOp::Remove;
+                record.course.courseNumber = courseInput;
+                CanonicalizeCourseKey(record.course.courseNumber);
+            }
+            else {
+                cout << "Invalid option." << endl;
+                break;
+            }
+
+            if (record.course.courseNumber.empty()) {
+                cout << "No course number entered." << endl;
+                break;
+            }
+
+            auto started = chrono::steady_clock::now();
+            EditResult result = ApplyCatalogEdit(catalog, catalogJournal, publisher, record);
+            if (result == EditResult::NotFound) {
+                cout << "Course not found." << endl;
+                break;
+            }
+            if (result == EditResult::NotDurable) {
+                cout << "The edit was not applied." << endl;
+                break;
+            }
+            auto elapsed = chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - started);
+            dataLoaded = true;
+            cout << "Course " << record.course.courseNumber
+                << (record.op == JournalOp::Upsert ? " saved" : " removed")
+                << " in " << elapsed.count() << " us"
+                << (catalogJournal.IsOpen() ? " (journaled)" : " (not journaled)") << endl;
+            break;
+        }
+
+        case 11:
+            if (!dataLoaded) {
+                cout << "\nError: No course data loaded. Please load data first.\n";
+                break;
+            }
+            cout << "Enter transcript file name: ";
+            getline(cin, filename);
+            if (!courseIds.IsCurrent(catalog)) courseIds.Build(catalog);
+            transcripts.Load(filename, courseIds, scheduler);
+            break;
+
+        case 12:
+            if (transcripts.StudentCount() == 0) {
+                cout << "\nError: No transcripts loaded. Please load transcripts first.\n";
+                break;
+            }
+            if (!courseIds.IsCurrent(catalog) || transcripts.CatalogRevision() != courseIds.Revision()) {
+                cout << "\nError: The catalog changed. Please reload transcripts.\n";
+                break;
+            }
+            cout << "Enter student id: ";
+            getline(cin, courseInput);
+            PrintStudentEligibility(string(TrimKeyWhitespace(courseInput)), transcripts, courseIds);
+            break;
+
+        case 13: {
+            if (transcripts.StudentCount() == 0) {
+                cout << "\nError: No transcripts loaded. Please load transcripts first.\n";
+                break;
+            }
+            if (!courseIds.IsCurrent(catalog) || transcripts.CatalogRevision() != courseIds.Revision()) {
+                cout << "\nError: The catalog changed. Please reload transcripts.\n";
+                break;
+            }
+            if (closure.Revision() != courseIds.Revision()) {
+                closure.Build(courseIds, scheduler);
+            }
+            if (closure.CyclicCourses() > 0) {
+                cout << "Warning: " << closure.CyclicCourses()
+                    << " courses are on prerequisite cycles and unlock nothing." << endl;
+            }
+
+            cout << "Enter target degree courses (press Enter for all courses): ";
+            getline(cin, courseInput);
+            CourseBitset target = ParseTargetCourses(courseInput, courseIds);
+
+            cout << "Enter student id (or * for every student): ";
+            getline(cin, courseInput);
+            string studentId(TrimKeyWhitespace(courseInput));
+            if (studentId == "*") {
+                cout << "Enter output file name: ";
+                getline(cin, filename);
+                ExportRecommendations(filename, transcripts, courseIds, closure, target, scheduler);
+                break;
+            }
+
+            uint32_t student = transcripts.FindStudent(studentId);
+            if (student == kNoStudent) {
+                cout << "Student not found." << endl;
+                break;
+            }
+            vector<Recommendation> ranked = RecommendCourses(courseIds, closure,
+                transcripts.CompletedSet(student), target, kRecommendationsPerStudent);
+            if (ranked.empty()) {
+                cout << "No further courses are available." << endl;
+                break;
+            }
+            for (size_t r = 0; r < ranked.size(); ++r) {
+                const Course& course = courseIds.GetCourse(ranked[r].course);
+                cout << r + 1 << ". " << course.courseNumber << ", " << course.courseTitle
+                    << " (unlocks " << ranked[r].unlockValue << ")" << endl;
+            }
+            break;
+        }
+
+        case 14: {
+            if (!dataLoaded) {
+                cout << "\nError: No course data loaded. Please load data first.\n";
+                break;
+            }
+            if (!courseIds.IsCurrent(catalog)) courseIds.Build(catalog);
+            cout << "Remove redundant prerequisites after reporting them? (Y/N): ";
+            getline(cin, courseInput);
+            CanonicalizeCourseKey(courseInput);
+            ReduceCatalogPrerequisites(catalog, catalogJournal, publisher, courseIds, scheduler,
+                courseInput == "Y");
+            break;
+        }
+
+        case 15:
+            if (!backgroundLoad.Pending()) {
+                cout << "No load is in progress." << endl;
+                break;
+            }
+            backgroundLoad.PrintProgress();
+            cout << "Cancel the load? (Y/N): ";
+            getline(cin, courseInput);
+            CanonicalizeCourseKey(courseInput);
+            if (courseInput == "Y") {
+                size_t rows = backgroundLoad.Cancel();
+                cout << "Load cancelled after " << rows
+                    << " rows; the catalog was not changed." << endl;
+            }
+            break;
+
+        case 16:
+            if (!dataLoaded) {
+                cout << "\nError: No course data loaded. Please load data first.\n";
+                break;
+            }
+            PrintMemoryReport(catalog);
+            cout << "Compact the catalog now? (Y/N): ";
+            getline(cin, courseInput);
+            CanonicalizeCourseKey(courseInput);
+            if (courseInput == "Y") {
+                size_t released;
+                {
+                    auto guard = publisher.LockCatalog();
+                    released = CompactCatalog(catalog);
+                }
+                if (backgroundIndex) BuildDerivedInBackground(catalog, derivedBuild);
+                cout << "Released " << released / 1024
+                    << " KB; the sorted and reverse indexes are rebuilt on next use." << endl;
+            }
             break;
 
         case 9: